@@ -0,0 +1,519 @@
+/* Reader microbenchmarks against a tree from mkfixture: ns per call and
+ * heap allocations per call, measured after one warm-up call so that
+ * steady-state costs are reported. */
+#include "cutedash.h"
+#include "parse.h"
+#include <math.h>
+
+int num_cores;
+int g_scan_workers, g_disk_parts;
+iface_t ifaces[MAX_IFACES];
+int num_ifaces;
+const char *g_proc_root, *g_sys_root, *g_cgroup_root, *g_docker_root;
+
+#define BENCH_MIN_NS 250000000.0
+#define BENCH_MAX_CALLS 100000
+
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+static unsigned long allocs;
+
+void *malloc(size_t n) {
+    __atomic_fetch_add(&allocs, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(n);
+}
+
+void *calloc(size_t n, size_t sz) {
+    __atomic_fetch_add(&allocs, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(n, sz);
+}
+
+void *realloc(void *p, size_t n) {
+    __atomic_fetch_add(&allocs, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(p, n);
+}
+
+static cpu_stat_t cpu, cpu_prev;
+static double cpu_pct[MAX_CORES + 1];
+static float cpu_state[CPU_NSTATES][MAX_CORES + 1];
+static unsigned long mem[7];
+static char t_labels[32][32];
+static double t_vals[32], t_highs[32], t_crits[32];
+static fan_info_t fans[16];
+static iface_t ifs[MAX_IFACES];
+static disk_io_t dio;
+static char mounts[MAX_MOUNTS][128];
+static mount_usage_t usage[MAX_MOUNTS];
+static proc_table_t procs;
+static docker_info_t docker[MAX_DOCKER];
+static irq_top_t irqs;
+static psi_t psi[PSI_NRES];
+
+static void b_cpu(void) { read_cpu_stats(&cpu); }
+static void b_cpu_pct(void) { calc_cpu_pct(&cpu, &cpu_prev, 0, cpu.count, cpu_pct, cpu_state[0], MAX_CORES + 1); }
+static void b_mem(void) { read_mem(&mem[0], &mem[1], &mem[2], &mem[3], &mem[4], &mem[5], &mem[6]); }
+static void b_temps(void) { read_temps(t_labels, t_vals, t_highs, t_crits, 32); }
+static void b_fans(void) { read_fans(fans, 16); }
+static void b_ifaces(void) { read_ifaces(ifs, MAX_IFACES); }
+static void b_disk_io(void) { read_disk_io(&dio); }
+static void b_loadavg(void) { double a, b, c; read_loadavg(&a, &b, &c); }
+static void b_mounts(void) { read_mounts(mounts, MAX_MOUNTS); }
+static void b_usage(void) { read_disk_usage(usage, MAX_MOUNTS, 0); }
+static void b_procs(void) { read_procs_with_cpu(&procs, mem[0]); }
+static void b_sort(void) { sort_procs(&procs, SORT_CPU, 50); }
+static void b_battery(void) { read_battery(); }
+static void b_docker(void) { read_docker(docker, MAX_DOCKER); }
+static void b_irqs(void) { read_irqs(&irqs); }
+static void b_psi(void) { read_psi(psi); }
+
+static const struct { const char *name; void (*fn)(void); } benches[] = {
+    { "read_cpu_stats", b_cpu },
+    { "calc_cpu_pct", b_cpu_pct },
+    { "read_mem", b_mem },
+    { "read_temps", b_temps },
+    { "read_fans", b_fans },
+    { "read_ifaces", b_ifaces },
+    { "read_disk_io", b_disk_io },
+    { "read_loadavg", b_loadavg },
+    { "read_mounts", b_mounts },
+    { "read_disk_usage", b_usage },
+    { "read_procs_with_cpu", b_procs },
+    { "sort_procs(top 50)", b_sort },
+    { "read_battery", b_battery },
+    { "read_docker", b_docker },
+    { "read_irqs", b_irqs },
+    { "read_psi", b_psi },
+};
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Parser comparisons run on the fixture files split into lines once, so
+ * only the parsing differs: the sscanf/strtoull code the readers used
+ * before parse.h against the cursor scanners they use now. */
+#define MAX_LINES 4096
+static char *lines[MAX_LINES];
+static size_t line_len[MAX_LINES];
+static int nlines;
+static volatile unsigned long long sink;
+
+static int load_lines(const char *path) {
+    static char buf[1 << 20];
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = 0;
+    nlines = 0;
+    for (char *p = buf; *p && nlines < MAX_LINES; ) {
+        lines[nlines] = p;
+        char *nl = strchr(p, '\n');
+        line_len[nlines++] = nl ? (size_t)(nl - p) : strlen(p);
+        if (!nl) break;
+        *nl = 0;
+        p = nl + 1;
+    }
+    return 0;
+}
+
+static void old_cpu(void) {
+    unsigned long long v[8];
+    for (int i = 0; i < nlines && strncmp(lines[i], "cpu", 3) == 0; i++) {
+        if (lines[i][3] == ' ')
+            sscanf(lines[i] + 4, "%llu %llu %llu %llu %llu %llu %llu %llu",
+                   &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]);
+        else
+            sscanf(lines[i] + 3, "%*d %llu %llu %llu %llu %llu %llu %llu %llu",
+                   &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]);
+        sink += v[0] + v[7];
+    }
+}
+
+static void new_cpu(void) {
+    unsigned long long v[8];
+    for (int i = 0; i < nlines && strncmp(lines[i], "cpu", 3) == 0; i++) {
+        const char *p = lines[i] + 3;
+        if (*p != ' ') scan_u64(&p);
+        for (int k = 0; k < 8; k++) v[k] = scan_u64(&p);
+        sink += v[0] + v[7];
+    }
+}
+
+static void old_meminfo(void) {
+    unsigned long v[6] = {0};
+    for (int i = 0; i < nlines; i++) {
+        const char *line = lines[i];
+        if (strncmp(line, "MemTotal:", 9) == 0) sscanf(line + 9, "%lu", &v[0]);
+        else if (strncmp(line, "MemAvailable:", 13) == 0) sscanf(line + 13, "%lu", &v[1]);
+        else if (strncmp(line, "Buffers:", 8) == 0) sscanf(line + 8, "%lu", &v[2]);
+        else if (strncmp(line, "Cached:", 7) == 0) sscanf(line + 7, "%lu", &v[3]);
+        else if (strncmp(line, "SwapTotal:", 10) == 0) sscanf(line + 10, "%lu", &v[4]);
+        else if (strncmp(line, "SwapFree:", 9) == 0) sscanf(line + 9, "%lu", &v[5]);
+    }
+    sink += v[0] + v[5];
+}
+
+static void new_meminfo(void) {
+    unsigned long long v[MI_COUNT] = {0};
+    unsigned found = 0;
+    for (int i = 0; i < nlines && found != (1u << MI_COUNT) - 1; i++) {
+        const char *colon = strchr(lines[i], ':');
+        int k = colon ? meminfo_key(lines[i], (size_t)(colon - lines[i])) : -1;
+        if (k < 0) continue;
+        const char *p = colon + 1;
+        v[k] = scan_u64(&p);
+        found |= 1u << k;
+    }
+    sink += v[0] + v[5];
+}
+
+static void old_netdev(void) {
+    for (int i = 2; i < nlines; i++) {
+        char *colon = strchr(lines[i], ':');
+        unsigned long long r, t;
+        if (colon && sscanf(colon + 1, "%llu %*u %*u %*u %*u %*u %*u %*u %llu", &r, &t) == 2) sink += r + t;
+    }
+}
+
+static void new_netdev(void) {
+    for (int i = 2; i < nlines; i++) {
+        const char *p = strchr(lines[i], ':');
+        if (!p) continue;
+        p++;
+        unsigned long long r = scan_u64(&p);
+        for (int k = 0; k < 7; k++) scan_u64(&p);
+        sink += r + scan_u64(&p);
+    }
+}
+
+static void old_diskstats(void) {
+    for (int i = 0; i < nlines; i++) {
+        unsigned int major, minor;
+        char devname[32];
+        int off = 0;
+        if (sscanf(lines[i], "%u %u %31s %n", &major, &minor, devname, &off) < 3 || !off) continue;
+        unsigned long long f[11];
+        char *p = lines[i] + off, *end;
+        for (int nf = 0; nf < 11; nf++, p = end) {
+            f[nf] = strtoull(p, &end, 10);
+            if (end == p) break;
+        }
+        sink += f[0] + f[10] + devname[0];
+    }
+}
+
+static void new_diskstats(void) {
+    for (int i = 0; i < nlines; i++) {
+        unsigned long long major, minor, f[11];
+        char devname[32];
+        const char *p = lines[i];
+        if (!scan_u64_n(&p, &major) || !scan_u64_n(&p, &minor) || !scan_word(&p, devname, sizeof(devname))) continue;
+        int nf = 0;
+        while (nf < 11 && scan_u64_n(&p, &f[nf])) nf++;
+        sink += f[0] + f[10] + devname[0];
+    }
+}
+
+static void old_pidstat(void) {
+    char *p = strrchr(lines[0], ')') + 2;
+    unsigned long long utime = 0, stime = 0, start = 0;
+    for (int field = 0; *p && field <= 19; field++) {
+        while (*p == ' ') p++;
+        if (field == 11) utime = strtoull(p, &p, 10);
+        else if (field == 12) stime = strtoull(p, &p, 10);
+        else if (field == 19) start = strtoull(p, &p, 10);
+        else while (*p && *p != ' ') p++;
+    }
+    sink += utime + stime + start;
+}
+
+static void new_pidstat(void) {
+    size_t n = line_len[0];
+    /* pid_max allows 7 digits, so ") " ends within 74 bytes: pid, " (",
+     * 63 bytes of comm. */
+    const char *end = lines[0] + n, *p = (const char *)memrchr(lines[0], ')', n < 74 ? n : 74) + 2;
+    unsigned long long utime, stime, start;
+    scan_pidstat(p, end, &utime, &stime, &start);
+    sink += utime + stime + start;
+}
+
+static void old_interrupts(void) {
+    for (int i = 1; i < nlines; i++) {
+        char *p = strchr(lines[i], ':') + 1, *q;
+        unsigned long sum = 0;
+        for (int j = 0; j < MAX_CORES; j++, p = q) {
+            unsigned long v = strtoul(p, &q, 10);
+            if (q == p) break;
+            sum += v;
+        }
+        sink += sum;
+    }
+}
+
+static void new_interrupts(void) {
+    static uint32_t v[MAX_CORES];
+    for (int i = 1; i < nlines; i++) {
+        const char *p = strchr(lines[i], ':') + 1;
+        int n = scan_cols(p, p + strlen(p), v, MAX_CORES);
+        unsigned long sum = 0;
+        for (int j = 0; j < n; j++) sum += v[j];
+        sink += sum;
+    }
+}
+
+static const struct { const char *name, *file; void (*old)(void), (*new)(void); } parsers[] = {
+    { "stat cpu lines", "proc/stat", old_cpu, new_cpu },
+    { "meminfo", "proc/meminfo", old_meminfo, new_meminfo },
+    { "net/dev", "proc/net/dev", old_netdev, new_netdev },
+    { "diskstats", "proc/diskstats", old_diskstats, new_diskstats },
+    { "<pid>/stat", "proc/1/stat", old_pidstat, new_pidstat },
+    { "interrupts", "proc/interrupts", old_interrupts, new_interrupts },
+};
+
+static double time_fn(void (*fn)(void)) {
+    fn();
+    double t0 = now_ns(), t;
+    int calls = 0;
+    do {
+        for (int i = 0; i < 64; i++) fn();
+        calls += 64;
+        t = now_ns() - t0;
+    } while (t < BENCH_MIN_NS / 5);
+    return t / calls;
+}
+
+/* --check: differential test of the parse.h scanners, skip_fields,
+ * scan_pidstat, scan_cols and meminfo_key against bytewise or libc references on random
+ * input drawn mostly from digits and blanks, so the word-at-a-time paths
+ * see both their fast and fallback cases. */
+static unsigned long long rng = 0x9e3779b97f4a7c15ULL;
+static unsigned long check_fail;
+
+static unsigned rnd(unsigned n) {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return (unsigned)((rng >> 32) % n);
+}
+
+static void fill(char *buf, size_t n) {
+    static const char rare[] = "\t\n.-+:()a";
+    for (size_t i = 0; i < n; i++) {
+        unsigned r = rnd(16);
+        buf[i] = r < 9 ? (char)('0' + rnd(10)) : r < 14 ? ' ' : r < 15 ? rare[rnd(sizeof(rare) - 1)] : (char)rnd(256);
+    }
+    if (!rnd(8)) buf[rnd((unsigned)n)] = 0;
+}
+
+static void check_report(const char *what, const char *buf, size_t n) {
+    if (check_fail++ >= 10) return;
+    printf("  %s mismatch on \"", what);
+    for (size_t i = 0; i < n && buf[i]; i++)
+        if (buf[i] >= 0x20 && buf[i] < 0x7f && buf[i] != '"' && buf[i] != '\\') putchar(buf[i]);
+        else printf("\\x%02x", (unsigned char)buf[i]);
+    printf("\"\n");
+}
+
+static const char *ref_skip_fields(const char *p, const char *end, int n) {
+    for (; n > 0 && p < end && *p; p++)
+        if (*p == ' ') n--;
+    return p;
+}
+
+static const char *ref_blanks(const char *p) {
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+static int ref_digits(const char *p) {
+    int n = 0;
+    while (p[n] >= '0' && p[n] <= '9') n++;
+    return n;
+}
+
+static void check_scanners(const char *buf, size_t n) {
+    const char *q = ref_blanks(buf), *cur = buf;
+    unsigned long long u = 7;
+    int nd = ref_digits(q), got = scan_u64_n(&cur, &u);
+    if (got != (nd > 0) || cur != q + nd || (nd && nd <= 19 && u != strtoull(q, NULL, 10)) || (!nd && u != 7))
+        check_report("scan_u64_n", buf, n);
+
+    cur = buf;
+    const char *qs = q + (*q == '-' || *q == '+');
+    nd = ref_digits(qs);
+    long long i = scan_i64(&cur);
+    if (cur != qs + nd || (nd && nd <= 18 && i != strtoll(q, NULL, 10)) || (!nd && i != 0))
+        check_report("scan_i64", buf, n);
+
+    cur = buf;
+    int nf = qs[nd] == '.' ? ref_digits(qs + nd + 1) : -1;
+    double d = 0.5, rd = 0;
+    got = scan_f64_n(&cur, &d);
+    if (nd + (nf > 0 ? nf : 0) > 0) {
+        char tmp[40];
+        size_t len = (size_t)(qs - q) + nd + (nf >= 0 ? 1 + nf : 0);
+        if (nd + nf <= 15 && len < sizeof(tmp)) {
+            memcpy(tmp, q, len);
+            tmp[len] = 0;
+            rd = strtod(tmp, NULL);
+        } else rd = d;
+        if (!got || cur != q + len || fabs(d - rd) > fabs(rd) * 1e-12)
+            check_report("scan_f64_n", buf, n);
+    } else if (got || d != 0.5) {
+        check_report("scan_f64_n", buf, n);
+    }
+
+    char word[8];
+    cur = buf;
+    size_t wl = scan_word(&cur, word, sizeof(word)), rl = 0;
+    while (q[rl] && q[rl] != ' ' && q[rl] != '\t' && q[rl] != '\n') rl++;
+    if (wl != rl || cur != q + rl || strlen(word) != (rl < sizeof(word) ? rl : sizeof(word) - 1) ||
+        memcmp(word, q, strlen(word)) != 0)
+        check_report("scan_word", buf, n);
+
+    for (int k = 0; k < 24; k++) {
+        const char *end = buf + rnd((unsigned)n + 1);
+        if (skip_fields(buf, end, k) != ref_skip_fields(buf, end, k)) { check_report("skip_fields", buf, n); break; }
+    }
+}
+
+/* Rows shaped like /proc/interrupts (" %10u" per column), then mutated. */
+static void check_cols(char *buf, size_t cap) {
+    int ncols = 1 + rnd(40);
+    size_t len = 0;
+    for (int j = 0; j < ncols && len + 12 < cap; j++) {
+        unsigned long long v = rnd(4) ? rnd(100000) : ((unsigned long long)rnd(100000) << 20) + rnd(1 << 20);
+        len += (size_t)snprintf(buf + len, cap - len, " %10llu", v % 10000000000ULL);
+    }
+    if (rnd(2)) len += (size_t)snprintf(buf + len, cap - len, "  IR-PCI-MSI 524288-edge  eth0");
+    buf[len++] = '\n';
+    for (int m = rnd(4); m > 0; m--) {
+        static const char mut[] = " 0123456789\t\n:a";
+        buf[rnd((unsigned)len)] = mut[rnd(sizeof(mut) - 1)];
+    }
+    buf[len] = 0;
+
+    static uint32_t out[64], ref[64];
+    int max = 1 + rnd(48), n = scan_cols(buf, buf + len, out, max), rn = 0;
+    const char *p = buf;
+    unsigned long long v;
+    while (rn < max && scan_u64_n(&p, &v)) ref[rn++] = (uint32_t)v;
+    if (n != rn || memcmp(out, ref, n * sizeof(uint32_t)) != 0) check_report("scan_cols", buf, len);
+}
+
+/* Lines shaped like /proc/<pid>/stat after "comm) ", then mutated; no NULs,
+ * which scan_pidstat does not accept. */
+static void check_pidstat(char *buf, size_t cap) {
+    size_t len = (size_t)snprintf(buf, cap, "S");
+    for (int f = 1; f < 52 && len + 24 < cap; f++) {
+        unsigned long long v = rnd(4) ? rnd(1000) : rnd(8) ? rnd(100000000) : ((unsigned long long)rnd(1 << 30) << 30) + rnd(1 << 30);
+        if (f >= 13 && f <= 18 && rnd(8)) v %= 100;
+        len += (size_t)snprintf(buf + len, cap - len, f == 6 && rnd(2) ? " -%llu" : " %llu", v);
+    }
+    for (int m = rnd(3); m > 0; m--) {
+        static const char mut[] = " 0123456789\t\n-a";
+        buf[rnd((unsigned)len)] = mut[rnd(sizeof(mut) - 1)];
+    }
+    if (!rnd(8)) len = rnd((unsigned)len);
+    buf[len] = 0;
+
+    unsigned long long u, s, t;
+    scan_pidstat(buf, buf + len, &u, &s, &t);
+    const char *p = ref_skip_fields(buf, buf + len, 11);
+    unsigned long long ru = scan_u64(&p), rs = scan_u64(&p);
+    p = ref_skip_fields(p, buf + len, 7);
+    if (u != ru || s != rs || t != scan_u64(&p)) check_report("scan_pidstat", buf, len);
+}
+
+static void check_meminfo(void) {
+    static const char *keys[MI_COUNT] = { "MemTotal", "MemAvailable", "Buffers", "Cached", "SwapTotal", "SwapFree" };
+    static const char *others[] = { "MemFree", "SwapCached", "Active", "Inactive", "Dirty", "Shmem", "Slab",
+                                    "Mapped", "Committed_AS", "VmallocUsed", "HugePages_Total", "DirectMap4k", "" };
+    for (int k = 0; k < MI_COUNT; k++)
+        if (meminfo_key(keys[k], strlen(keys[k])) != k) check_report("meminfo_key", keys[k], strlen(keys[k]));
+    for (size_t k = 0; k < sizeof(others) / sizeof(*others); k++)
+        if (meminfo_key(others[k], strlen(others[k])) != -1) check_report("meminfo_key", others[k], strlen(others[k]));
+    for (int r = 0; r < 100000; r++) {
+        char key[16];
+        size_t len = 1 + rnd(14);
+        for (size_t i = 0; i < len; i++) key[i] = "MemTotalAvilbCchdSwpFre"[rnd(23)];
+        key[len] = 0;
+        int want = -1;
+        for (int k = 0; k < MI_COUNT; k++)
+            if (strcmp(key, keys[k]) == 0) want = k;
+        if (meminfo_key(key, len) != want) check_report("meminfo_key", key, len);
+    }
+}
+
+static int run_check(long rounds) {
+    static char buf[600];
+    for (long r = 0; r < rounds; r++) {
+        size_t n = 1 + rnd(64);
+        fill(buf, n);
+        buf[n] = 0;
+        check_scanners(buf, n);
+        check_cols(buf, sizeof(buf) - 1);
+        check_pidstat(buf, sizeof(buf) - 1);
+    }
+    check_meminfo();
+    printf("check: %ld rounds, %lu mismatches\n", rounds, check_fail);
+    return check_fail != 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "--check") == 0) return run_check(argc > 2 ? atol(argv[2]) : 1000000);
+    if (argc != 2) { fprintf(stderr, "usage: bench FIXTURE_DIR | bench --check [ROUNDS]\n"); return 1; }
+    static char proc[512], sys[512], cgroup[512], docker_root[512], stamp[512];
+    char *dir = realpath(argv[1], NULL);
+    if (dir) argv[1] = dir;
+    snprintf(proc, sizeof(proc), "%s/proc", argv[1]);
+    snprintf(sys, sizeof(sys), "%s/sys", argv[1]);
+    snprintf(cgroup, sizeof(cgroup), "%s/sys/fs/cgroup", argv[1]);
+    snprintf(docker_root, sizeof(docker_root), "%s/docker", argv[1]);
+    g_proc_root = proc;
+    g_sys_root = sys;
+    g_cgroup_root = cgroup;
+    g_docker_root = docker_root;
+    if (getenv("BENCH_WORKERS")) g_scan_workers = atoi(getenv("BENCH_WORKERS"));
+
+    char desc[128] = "";
+    snprintf(stamp, sizeof(stamp), "%s/fixture", argv[1]);
+    FILE *f = fopen(stamp, "r");
+    if (!f || !fgets(desc, sizeof(desc), f)) { fprintf(stderr, "bench: %s is not a fixture\n", argv[1]); return 1; }
+    fclose(f);
+    desc[strcspn(desc, "\n")] = 0;
+
+    read_cpu_stats(&cpu_prev);
+    read_cpu_stats(&cpu);
+    num_cores = cpu.count - 1;
+    b_mem();
+    printf("%s (%s)\n", argv[1], desc);
+    printf("  %-22s %8s %14s %12s\n", "reader", "calls", "ns/call", "allocs/call");
+    for (size_t i = 0; i < sizeof(benches) / sizeof(*benches); i++) {
+        benches[i].fn();
+        unsigned long a0 = allocs;
+        double t0 = now_ns(), t;
+        int calls = 0;
+        do {
+            benches[i].fn();
+            calls++;
+            t = now_ns() - t0;
+        } while (calls < BENCH_MAX_CALLS && (t < BENCH_MIN_NS || calls < 3));
+        printf("  %-22s %8d %14.0f %12.2f\n", benches[i].name, calls, t / calls,
+               (double)(allocs - a0) / calls);
+    }
+
+    printf("  %-22s %14s %14s %8s\n", "parser", "sscanf ns", "parse.h ns", "speedup");
+    for (size_t i = 0; i < sizeof(parsers) / sizeof(*parsers); i++) {
+        char path[600];
+        snprintf(path, sizeof(path), "%s/%s", argv[1], parsers[i].file);
+        if (load_lines(path) != 0) continue;
+        double o = time_fn(parsers[i].old), n = time_fn(parsers[i].new);
+        printf("  %-22s %14.0f %14.0f %7.1fx\n", parsers[i].name, o, n, o / n);
+    }
+    return 0;
+}
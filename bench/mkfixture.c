@@ -0,0 +1,346 @@
+/* Builds a synthetic procfs/sysfs tree for the reader benchmarks:
+ *   DIR/proc   stat, meminfo, net/dev, diskstats, loadavg, uptime,
+ *              self/mounts and one <pid>/{stat,statm} per process
+ *   DIR/sys    class/hwmon, class/power_supply/BAT0, class/block, fs/cgroup,
+ *              devices/system/{cpu,node} topology
+ *   DIR/docker containers/<id>/config.v2.json
+ * A tree built with the same parameters is reused. */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static char root[400];
+static unsigned long long rng = 0x9e3779b97f4a7c15ULL;
+
+static unsigned rnd(unsigned n) {
+    rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (unsigned)(rng >> 33) % n;
+}
+
+static void mkdirs(const char *path) {
+    char buf[512];
+    snprintf(buf, sizeof(buf), "%s", path);
+    for (char *p = buf + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = 0;
+        mkdir(buf, 0755);
+        *p = '/';
+    }
+    if (mkdir(buf, 0755) != 0 && errno != EEXIST) { perror(buf); exit(1); }
+}
+
+static FILE *create(const char *fmt, ...) {
+    char rel[400], path[820];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(rel, sizeof(rel), fmt, ap);
+    va_end(ap);
+    snprintf(path, sizeof(path), "%s/%s", root, rel);
+    FILE *f = fopen(path, "w");
+    if (!f && errno == ENOENT) {
+        char *slash = strrchr(path, '/');
+        *slash = 0;
+        mkdirs(path);
+        *slash = '/';
+        f = fopen(path, "w");
+    }
+    if (!f) { perror(path); exit(1); }
+    return f;
+}
+
+static const char *names[] = {
+    "systemd", "kworker/0:1H-kblockd", "bash", "sshd", "nginx", "postgres", "java",
+    "python3", "containerd-shim", "Web Content", "tmux: server", "node", "ksoftirqd/3",
+    "rcu_sched", "(sd-pam)", "dockerd", "chrome", "redis-server", "cron", "journald",
+};
+
+static void gen_proc(int cores, int procs, int ifaces) {
+    FILE *f = create("proc/stat");
+    unsigned long long tot[8] = {0};
+    unsigned long long per[1024][8];
+    for (int c = 0; c < cores && c < 1024; c++)
+        for (int k = 0; k < 8; k++) tot[k] += per[c][k] = 1000 + rnd(k == 3 ? 9000000 : 400000);
+    fprintf(f, "cpu  %llu %llu %llu %llu %llu %llu %llu %llu 0 0\n",
+            tot[0], tot[1], tot[2], tot[3], tot[4], tot[5], tot[6], tot[7]);
+    for (int c = 0; c < cores && c < 1024; c++)
+        fprintf(f, "cpu%d %llu %llu %llu %llu %llu %llu %llu %llu 0 0\n", c,
+                per[c][0], per[c][1], per[c][2], per[c][3], per[c][4], per[c][5], per[c][6], per[c][7]);
+    fprintf(f, "intr 123456789 0 9 0 0\nctxt 987654321\nbtime 1700000000\nprocesses %d\n"
+               "procs_running 3\nprocs_blocked 0\nsoftirq 5555 0 1 2 3 4 5 6 7 8 9\n", procs * 3);
+    fclose(f);
+
+    f = create("proc/meminfo");
+    static const char *keys[] = {
+        "MemTotal", "MemFree", "MemAvailable", "Buffers", "Cached", "SwapCached", "Active",
+        "Inactive", "Active(anon)", "Inactive(anon)", "Active(file)", "Inactive(file)",
+        "Unevictable", "Mlocked", "SwapTotal", "SwapFree", "Zswap", "Zswapped", "Dirty",
+        "Writeback", "AnonPages", "Mapped", "Shmem", "KReclaimable", "Slab", "SReclaimable",
+        "SUnreclaim", "KernelStack", "PageTables", "SecPageTables", "NFS_Unstable", "Bounce",
+        "WritebackTmp", "CommitLimit", "Committed_AS", "VmallocTotal", "VmallocUsed",
+        "VmallocChunk", "Percpu", "HardwareCorrupted", "AnonHugePages", "ShmemHugePages",
+        "ShmemPmdMapped", "FileHugePages", "FilePmdMapped", "Unaccepted", "HugePages_Total",
+        "HugePages_Free", "HugePages_Rsvd", "HugePages_Surp", "Hugepagesize", "Hugetlb",
+        "DirectMap4k", "DirectMap2M", "DirectMap1G",
+    };
+    for (size_t i = 0; i < sizeof(keys) / sizeof(*keys); i++) {
+        static const unsigned long fixed[] = { 65843212, 9120444, 41233876, 1203312, 28402112 };
+        unsigned long v = i < 5 ? fixed[i] : i == 14 ? 8388604 : i == 15 ? 8121340 : rnd(4000000);
+        fprintf(f, "%s:%*s%lu kB\n", keys[i], (int)(15 - strlen(keys[i])), "", v);
+    }
+    fclose(f);
+
+    f = create("proc/net/dev");
+    fprintf(f, "Inter-|   Receive                                                |  Transmit\n"
+               " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed\n"
+               "    lo: 123456789  654321    0    0    0     0          0         0 123456789  654321    0    0    0     0       0          0\n");
+    for (int i = 0; i < ifaces; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "%s%d", i & 1 ? "veth" : "eth", i);
+        fprintf(f, "%6s: %u %u 0 0 0 0 0 %u %u %u 0 0 0 0 0 0\n", name,
+                rnd(2000000000), rnd(9000000), rnd(1000), rnd(2000000000), rnd(9000000));
+    }
+    fclose(f);
+
+    f = create("proc/diskstats");
+    static const char *disks[] = {
+        "loop0", "loop1", "loop2", "loop3", "sda", "sda1", "sda2", "sda3",
+        "nvme0n1", "nvme0n1p1", "nvme0n1p2", "mmcblk0", "mmcblk0p1", "mmcblk0boot0",
+        "mmcblk0boot1", "sr0", "md1", "md10", "dm-0", "dm-1",
+    };
+    static const char *parts[] = { "sda1", "sda2", "sda3", "nvme0n1p1", "nvme0n1p2", "mmcblk0p1" };
+    for (size_t i = 0; i < sizeof(parts) / sizeof(*parts); i++) {
+        FILE *pf = create("sys/class/block/%s/partition", parts[i]);
+        fprintf(pf, "%zu\n", i + 1);
+        fclose(pf);
+    }
+    for (size_t i = 0; i < sizeof(disks) / sizeof(*disks); i++)
+        fprintf(f, "%4d %7zu %s %u 0 %u %u %u 0 %u %u 0 %u %u 0 0 0 0 0 0\n", 8, i, disks[i],
+                rnd(900000), rnd(90000000), rnd(900000), rnd(900000), rnd(90000000), rnd(900000),
+                rnd(900000), rnd(1800000));
+    fclose(f);
+
+    f = create("proc/loadavg");
+    fprintf(f, "1.52 1.38 1.21 3/%d %d\n", procs, procs + 1);
+    fclose(f);
+    f = create("proc/uptime");
+    fprintf(f, "864000.42 %d.17\n", 864000 * cores);
+    fclose(f);
+    f = create("proc/self/mounts");
+    fprintf(f, "sysfs /sys sysfs rw,nosuid,nodev,noexec,relatime 0 0\n"
+               "proc /proc proc rw,nosuid,nodev,noexec,relatime 0 0\n"
+               "/dev/loop0 /snap/core/1 squashfs ro 0 0\n"
+               "/dev/vda1 %s ext4 rw,relatime 0 0\n"
+               "/dev/vda2 %s/proc ext4 rw,relatime 0 0\n"
+               "tmpfs /run tmpfs rw 0 0\n", root, root);
+    fclose(f);
+
+    static const char *psi[] = { "cpu", "memory", "io" };
+    for (int r = 0; r < 3; r++) {
+        f = create("proc/pressure/%s", psi[r]);
+        for (int k = 0; k < 2; k++)
+            fprintf(f, "%s avg10=%u.%02u avg60=%u.%02u avg300=%u.%02u total=%u\n", k ? "full" : "some",
+                    rnd(20), rnd(100), rnd(10), rnd(100), rnd(5), rnd(100), rnd(900000000));
+        fclose(f);
+    }
+
+    for (int pid = 1; pid <= procs; pid++) {
+        const char *name = names[rnd(sizeof(names) / sizeof(*names))];
+        f = create("proc/%d/stat", pid);
+        fprintf(f, "%d (%s) S %d %d %d 0 -1 4194560 %u 0 %u 0 %u %u 0 0 20 0 %u 0 %u %u %u "
+                   "18446744073709551615 1 1 0 0 0 0 0 4096 0 0 0 17 %u 0 0 0 0 0 0 0 0 0 0 0 0 0\n",
+                pid, name, pid > 1 ? 1 + rnd(pid - 1) : 0, pid, pid, rnd(100000), rnd(1000),
+                rnd(500000), rnd(200000), 1 + rnd(32), rnd(80000000), rnd(900000000),
+                rnd(200000), rnd(cores));
+        fclose(f);
+        f = create("proc/%d/statm", pid);
+        unsigned rss = rnd(200000);
+        fprintf(f, "%u %u %u 100 0 %u 0\n", rss * 3, rss, rss / 4, rss);
+        fclose(f);
+    }
+}
+
+static void gen_sys(int chips, int cgroups) {
+    for (int c = 0; c < chips; c++) {
+        FILE *f = create("sys/class/hwmon/hwmon%d/name", c);
+        fprintf(f, "%s\n", c == 0 ? "coretemp" : c == 1 ? "nvme" : "acpitz");
+        fclose(f);
+        for (int t = 1; t <= 4; t++) {
+            f = create("sys/class/hwmon/hwmon%d/temp%d_input", c, t);
+            fprintf(f, "%u\n", 30000 + rnd(50000));
+            fclose(f);
+            f = create("sys/class/hwmon/hwmon%d/temp%d_max", c, t);
+            fprintf(f, "90000\n");
+            fclose(f);
+            f = create("sys/class/hwmon/hwmon%d/temp%d_crit", c, t);
+            fprintf(f, "100000\n");
+            fclose(f);
+            if (c == 0) {
+                f = create("sys/class/hwmon/hwmon%d/temp%d_label", c, t);
+                fprintf(f, "Core %d\n", t - 1);
+                fclose(f);
+            }
+        }
+        f = create("sys/class/hwmon/hwmon%d/fan1_input", c);
+        fprintf(f, "%u\n", 800 + rnd(2000));
+        fclose(f);
+    }
+
+    FILE *f = create("sys/class/power_supply/BAT0/present");
+    fprintf(f, "1\n");
+    fclose(f);
+    f = create("sys/class/power_supply/BAT0/capacity");
+    fprintf(f, "87\n");
+    fclose(f);
+    f = create("sys/class/power_supply/BAT0/status");
+    fprintf(f, "Discharging\n");
+    fclose(f);
+
+    for (int i = 0; i < cgroups; i++) {
+        char id[65];
+        for (int k = 0; k < 64; k++) id[k] = "0123456789abcdef"[rnd(16)];
+        id[64] = 0;
+        const char *dir = "sys/fs/cgroup/system.slice/docker-";
+        f = create("%s%s.scope/cpu.stat", dir, id);
+        fprintf(f, "usage_usec %u\nuser_usec %u\nsystem_usec %u\nnr_periods 0\nnr_throttled 0\n"
+                   "throttled_usec 0\n", rnd(2000000000), rnd(1000000000), rnd(1000000000));
+        fclose(f);
+        f = create("%s%s.scope/memory.current", dir, id);
+        fprintf(f, "%u\n", rnd(2000000000));
+        fclose(f);
+        f = create("%s%s.scope/io.stat", dir, id);
+        fprintf(f, "8:0 rbytes=%u wbytes=%u rios=%u wios=%u dbytes=0 dios=0\n"
+                   "259:0 rbytes=%u wbytes=%u rios=%u wios=%u dbytes=0 dios=0\n",
+                rnd(2000000000), rnd(2000000000), rnd(90000), rnd(90000),
+                rnd(2000000000), rnd(2000000000), rnd(90000), rnd(90000));
+        fclose(f);
+        f = create("%s%s.scope/pids.current", dir, id);
+        fprintf(f, "%u\n", 1 + rnd(200));
+        fclose(f);
+        f = create("%s%s.scope/cgroup.freeze", dir, id);
+        fprintf(f, "%d\n", i % 7 == 6);
+        fclose(f);
+        f = create("docker/containers/%s/config.v2.json", id);
+        fprintf(f, "{\"ID\":\"%s\",\"Created\":\"2024-01-01T00:00:00Z\",\"Config\":{\"Env\":[", id);
+        for (int e = 0; e < 200; e++) fprintf(f, "%s\"VAR_%d=%064d\"", e ? "," : "", e, e);
+        fprintf(f, "],\"Labels\":{\"Name\":\"label-%d\"}},\"NetworkSettings\":{},\"Name\":\"/svc-%d\"}\n", i, i);
+        fclose(f);
+    }
+}
+
+/* Two NUMA nodes, one socket each, with cores interleaved between them. */
+static void gen_topology(int cores) {
+    int nodes = cores > 1 ? 2 : 1;
+    for (int n = 0; n < nodes; n++) {
+        FILE *f = create("sys/devices/system/node/node%d/cpulist", n);
+        for (int c = n; c < cores; c += nodes) fprintf(f, "%s%d", c == n ? "" : ",", c);
+        fprintf(f, "\n");
+        fclose(f);
+    }
+    for (int c = 0; c < cores; c++) {
+        FILE *f = create("sys/devices/system/cpu/cpu%d/topology/physical_package_id", c);
+        fprintf(f, "%d\n", c % nodes);
+        fclose(f);
+    }
+}
+
+/* Kernel layout: a "%*d: " or "%*s: " label, then " %10u" per CPU. NIC
+ * and NVMe queue vectors each land on one core, the rest are spread. */
+static void gen_irqs(int cores) {
+    static const char *arch[][2] = {
+        { "NMI", "Non-maskable interrupts" }, { "LOC", "Local timer interrupts" },
+        { "SPU", "Spurious interrupts" }, { "PMI", "Performance monitoring interrupts" },
+        { "IWI", "IRQ work interrupts" }, { "RTR", "APIC ICR read retries" },
+        { "RES", "Rescheduling interrupts" }, { "CAL", "Function call interrupts" },
+        { "TLB", "TLB shootdowns" }, { "TRM", "Thermal event interrupts" },
+        { "THR", "Threshold APIC interrupts" }, { "DFR", "Deferred Error APIC interrupts" },
+        { "MCE", "Machine check exceptions" }, { "MCP", "Machine check polls" },
+    };
+    static const char *soft[] = {
+        "HI", "TIMER", "NET_TX", "NET_RX", "BLOCK", "IRQ_POLL", "TASKLET", "SCHED", "HRTIMER", "RCU",
+    };
+    int nic = cores < 64 ? cores : 64, nvme = cores < 32 ? cores : 32;
+    FILE *f = create("proc/interrupts");
+    fprintf(f, "%*s", 3 + 8, "");
+    for (int c = 0; c < cores; c++) fprintf(f, "CPU%-8d", c);
+    fprintf(f, "\n");
+    for (int i = 0; i < 3 + nic + nvme; i++) {
+        int irq = i < 3 ? (int[]){ 0, 8, 9 }[i] : i < 3 + nic ? 100 + i - 3 : 300 + i - 3 - nic;
+        int pin = i < 3 ? -1 : i < 3 + nic ? i - 3 : (i - 3 - nic) * cores / nvme;
+        fprintf(f, "%3d: ", irq);
+        for (int c = 0; c < cores; c++) fprintf(f, "%10u ", pin < 0 ? rnd(100) : c == pin ? rnd(2000000000) : 0);
+        if (i < 3) fprintf(f, "  IO-APIC   %d-edge      %s\n", irq, (const char *[]){ "timer", "rtc0", "acpi" }[i]);
+        else if (i < 3 + nic) fprintf(f, "  IR-PCI-MSIX-0000:3b:00.0 %d-edge      eth0-TxRx-%d\n", i - 3, i - 3);
+        else fprintf(f, "  IR-PCI-MSIX-0000:5e:00.0 %d-edge      nvme0q%d\n", i - 3 - nic, i - 3 - nic);
+    }
+    for (size_t i = 0; i < sizeof(arch) / sizeof(*arch); i++) {
+        fprintf(f, "%3s: ", arch[i][0]);
+        for (int c = 0; c < cores; c++) fprintf(f, "%10u ", i == 1 ? 100000000 + rnd(900000000) : rnd(50000));
+        fprintf(f, "  %s\n", arch[i][1]);
+    }
+    fprintf(f, "%3s: %10u\n%3s: %10u\n", "ERR", 0, "MIS", 0);
+    fclose(f);
+
+    f = create("proc/softirqs");
+    fprintf(f, "%20s", "");
+    for (int c = 0; c < cores; c++) fprintf(f, "CPU%-8d", c);
+    fprintf(f, "\n");
+    for (size_t i = 0; i < sizeof(soft) / sizeof(*soft); i++) {
+        fprintf(f, "%12s:", soft[i]);
+        for (int c = 0; c < cores; c++) fprintf(f, " %10u", rnd(i == 3 && c < nic ? 2000000000 : 5000000));
+        fprintf(f, "\n");
+    }
+    fclose(f);
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: mkfixture [-c CORES] [-p PROCS] [-i IFACES] [-s CHIPS] [-g CGROUPS] DIR\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    int cores = 64, procs = 1000, ifaces = 8, chips = 4, cgroups = 16, opt;
+    while ((opt = getopt(argc, argv, "c:p:i:s:g:")) != -1) {
+        switch (opt) {
+        case 'c': cores = atoi(optarg); break;
+        case 'p': procs = atoi(optarg); break;
+        case 'i': ifaces = atoi(optarg); break;
+        case 's': chips = atoi(optarg); break;
+        case 'g': cgroups = atoi(optarg); break;
+        default: usage();
+        }
+    }
+    if (optind != argc - 1 || cores < 1 || cores > 1024 || procs < 0 || ifaces < 0 ||
+        ifaces > 15 || chips < 0 || cgroups < 0 || cgroups > 32) usage();
+    snprintf(root, sizeof(root), "%s", argv[optind]);
+    mkdirs(root);
+
+    char want[128], have[128] = "", stamp[512];
+    snprintf(want, sizeof(want), "cores=%d procs=%d ifaces=%d chips=%d cgroups=%d\n",
+             cores, procs, ifaces, chips, cgroups);
+    snprintf(stamp, sizeof(stamp), "%s/fixture", root);
+    FILE *f = fopen(stamp, "r");
+    if (f) {
+        if (!fgets(have, sizeof(have), f)) have[0] = 0;
+        fclose(f);
+    }
+    if (strcmp(want, have) == 0) return 0;
+    if (have[0]) {
+        fprintf(stderr, "mkfixture: %s holds a different fixture (%.*s)\n", root,
+                (int)strcspn(have, "\n"), have);
+        return 1;
+    }
+
+    gen_proc(cores, procs, ifaces);
+    gen_sys(chips, cgroups);
+    gen_topology(cores);
+    gen_irqs(cores);
+    f = create("fixture");
+    fputs(want, f);
+    fclose(f);
+    return 0;
+}
@@ -15,13 +15,21 @@
 #include <sys/statvfs.h>
 #include <getopt.h>
 #include <signal.h>
+#include <stdint.h>
 
-#define MAX_CORES 128
-#define MAX_PROCS 512
+#define MAX_CORES 2048
+#define MAX_CPU_GROUPS 64
 #define MAX_IFACES 16
 #define MAX_DOCKER 32
+#define MAX_MOUNTS 32
+#define MAX_GPUS 8
+#define MAX_DISKS 16
+#define MAX_IRQ_TOP 10
+#define IRQ_TOP_CPUS 3
+#define PSI_ALERT_HOLD_S 5
 #define HISTORY_LEN 120
 #define REFRESH_MS 1000
+#define MIN_INTERVAL_MS 100
 #define BAR_FULL "\u2501"
 #define BAR_DIM  "\u2500"
 
@@ -35,25 +43,70 @@ enum {
 
 enum { THEME_DEFAULT = 0, THEME_NEON, THEME_LIGHT, THEME_COUNT };
 enum { SORT_CPU = 0, SORT_MEM, SORT_PID };
+enum { HIST_CPU = 0, HIST_MEM, HIST_NET_RX, HIST_NET_TX, HIST_DISK_READ, HIST_DISK_WRITE,
+       HIST_CPU_STEAL, HIST_CPU_IOWAIT, HIST_PSI_CPU, HIST_PSI_MEM, HIST_PSI_IO, HIST_LOAD1, HIST_SWAP,
+       HIST_COUNT };
+enum { HIST_MEAN = 0, HIST_MIN, HIST_MAX };
+enum { HKEY_DISK_UTIL = 0, HKEY_DISK_IOPS, HKEY_TEMP, HKEY_IFACE_RX, HKEY_IFACE_TX,
+       HKEY_GPU_UTIL, HKEY_GPU_MEM, HKEY_GPU_TEMP };
+enum { PSI_CPU = 0, PSI_MEM, PSI_IO, PSI_NRES };
+enum { CPU_USER = 0, CPU_SYSTEM, CPU_IOWAIT, CPU_IRQ, CPU_SOFTIRQ, CPU_STEAL, CPU_NSTATES };
 
+extern const int cpu_state_colors[CPU_NSTATES];
+extern const char *cpu_state_names[CPU_NSTATES];
+extern const char *psi_names[PSI_NRES];
+
+#define HIST_TIERS 3
+#define HIST_NWINDOWS 6
+
+/* Jiffy counters from /proc/stat, one array per field. Row 0 is the
+ * aggregate "cpu" line (id -1); row i + 1 is the i-th online core. */
 typedef struct {
-    unsigned long long user, nice, system, idle, iowait, irq, softirq, steal;
-    unsigned long long total, busy;
+    int count, cap;
+    int *id;
+    unsigned long long *user, *nice, *system, *idle, *iowait, *irq, *softirq, *steal;
+    unsigned long long *total, *busy;
+    void *arena;
 } cpu_stat_t;
 
 typedef struct {
-    int pid;
-    char name[64];
-    double cpu_pct;
-    double mem_pct;
-    unsigned long long prev_total, prev_utime, prev_stime;
-} proc_info_t;
+    int node, pkg, start, len;
+} cpu_group_t;
+
+/* Heatmap display order: core indices grouped by NUMA node, then socket. */
+typedef struct {
+    int n, ngroups;
+    uint16_t *order;
+    cpu_group_t group[MAX_CPU_GROUPS];
+} cpu_topo_t;
+
+typedef struct {
+    double key;
+    uint32_t idx;
+} sort_key_t;
+
+typedef struct {
+    int count, cap, ntop;
+    int *pid;
+    double *cpu_pct;
+    double *mem_pct;
+    uint32_t *name;
+    uint32_t *order;
+    sort_key_t *keys;
+    void *arena;
+    char *names;
+    size_t names_len, names_cap;
+    uint32_t *intern;
+    size_t intern_cap;
+} proc_table_t;
+
+#define PROC_NAME(t, i) ((t)->names + (t)->name[i])
 
 typedef struct {
     char name[32];
     unsigned long long rx, tx;
     double rx_speed, tx_speed;
-    unsigned long long prev_rx, prev_tx;
+    double ts;
 } iface_t;
 
 typedef struct {
@@ -62,6 +115,8 @@ typedef struct {
     char status[16];
     double cpu_pct;
     double mem_mb;
+    double io_read_bps, io_write_bps;
+    int pids;
 } docker_info_t;
 
 typedef struct {
@@ -76,15 +131,24 @@ typedef struct {
     char status[16];
 } battery_t;
 
+typedef struct {
+    char name[32];
+    int partition, seen, primed;
+    unsigned long long rd_ios, wr_ios, rd_sec, wr_sec, rd_ticks, wr_ticks, io_ticks, queue_ticks;
+    double read_iops, write_iops, read_bps, write_bps;
+    double util, await_ms, queue;
+} disk_dev_t;
+
 typedef struct {
     unsigned long long prev_read, prev_write;
+    double prev_ts;
     double read_speed, write_speed;
-    double read_hist[HISTORY_LEN], write_hist[HISTORY_LEN];
-    int hist_len, hist_pos;
+    disk_dev_t dev[MAX_DISKS];
+    int ndev;
 } disk_io_t;
 
 typedef struct {
-    int has_gpu;
+    int index;
     char name[64];
     int temp;
     int fan_pct;
@@ -94,33 +158,123 @@ typedef struct {
     int mem_total_mb;
     int power_w;
     int power_max_w;
+    int stale;
 } gpu_info_t;
 
+typedef struct {
+    char path[128];
+    double used, total;
+    int unresponsive;
+} mount_usage_t;
+
+/* One interrupt source: a /proc/interrupts row or a softirq type, with
+ * the CPUs that took most of it since the previous read. */
+typedef struct {
+    char name[40];
+    double rate;
+    int ncpus;
+    int cpu[IRQ_TOP_CPUS];
+    float cpu_rate[IRQ_TOP_CPUS];
+} irq_src_t;
+
+typedef struct {
+    int nhard, nsoft;
+    double hard_rate, soft_rate;
+    irq_src_t hard[MAX_IRQ_TOP], soft[MAX_IRQ_TOP];
+} irq_top_t;
+
+/* /proc/pressure/<res>: share of wall time in which some (or, for "full",
+ * all) runnable tasks were stalled on the resource. avg[] are the kernel's
+ * 10s/60s/300s averages; rate comes from the stall totals since the
+ * previous read. The trigger fields are filled in by the sampler. */
+typedef struct {
+    int present;
+    double some[3], full[3];
+    double some_rate, full_rate;
+    unsigned long long some_total, full_total;
+    int trig_stall_ms, trig_window_ms;
+    unsigned events;
+    double event_wall;
+} psi_t;
+
+typedef struct {
+    double cpu_pct, syscalls_per_tick;
+    long rss_kb;
+} prof_self_t;
+
+typedef struct {
+    int valid;
+    double ts, wall;
+    long uptime;
+    int num_cores;
+    double core_pcts[MAX_CORES];
+    double cpu_avg;
+    float cpu_state[CPU_NSTATES];
+    float core_state[CPU_NSTATES][MAX_CORES];
+    double load1, load5, load15;
+
+    unsigned long mem_total, mem_avail, mem_used, mem_buf, mem_cached, sw_total, sw_free;
+
+    char t_labels[32][32];
+    double t_vals[32], t_highs[32], t_crits[32];
+    int t_count;
+    fan_info_t fans[16];
+    int fan_count;
+
+    iface_t ifaces[MAX_IFACES];
+    int num_ifaces;
+    double total_rx_speed, total_tx_speed;
+
+    disk_io_t disk_io;
+    mount_usage_t mounts[MAX_MOUNTS];
+    int mount_count;
+
+    proc_table_t procs;
+    gpu_info_t gpus[MAX_GPUS];
+    int gpu_count;
+    docker_info_t docker[MAX_DOCKER];
+    int docker_count;
+    battery_t bat;
+    irq_top_t irq;
+    psi_t psi[PSI_NRES];
+} sample_t;
+
 extern int g_theme;
 extern int g_sort;
 extern int g_once;
 extern int g_alert_cpu;
 extern int g_alert_temp;
+extern int g_alert_psi;
 extern int g_alert_flash;
+extern int g_scan_workers;
+extern int g_disk_parts;
+extern int g_window;
+extern const char *g_proc_root;
+extern const char *g_sys_root;
+extern const char *g_cgroup_root;
+extern const char *g_docker_root;
+extern const char *g_status;
+extern int g_profile;
+extern int g_cpu_heatmap;
+extern int g_irq_panel;
+extern int g_psi_panel;
 extern volatile int g_resize;
 
-extern cpu_stat_t prev_cpu[MAX_CORES + 1];
+extern cpu_stat_t prev_cpu;
 extern int num_cores;
-extern double cpu_history[HISTORY_LEN];
-extern int cpu_hist_len, cpu_hist_pos;
+extern cpu_topo_t cpu_topo;
 
 extern iface_t ifaces[MAX_IFACES];
 extern int num_ifaces;
-extern double net_rx_hist[HISTORY_LEN], net_tx_hist[HISTORY_LEN];
-extern int net_hist_len, net_hist_pos;
 
 extern disk_io_t disk_io;
 
-extern proc_info_t prev_procs[MAX_PROCS];
-extern int prev_nprocs;
-
-void read_cpu_stats(cpu_stat_t *stats, int *count);
-double calc_cpu_pct(cpu_stat_t *cur, cpu_stat_t *prev);
+double mono_now(void);
+void read_cpu_stats(cpu_stat_t *st);
+int cpu_stat_match(const cpu_stat_t *a, const cpu_stat_t *b);
+void calc_cpu_pct(const cpu_stat_t *cur, const cpu_stat_t *prev, int row, int n,
+                  double *busy, float *state, int stride);
+int read_cpu_topology(const cpu_stat_t *st, cpu_topo_t *t);
 void read_mem(unsigned long *total, unsigned long *avail, unsigned long *used,
               unsigned long *buffers, unsigned long *cached,
               unsigned long *sw_total, unsigned long *sw_free);
@@ -128,26 +282,88 @@ int read_temps(char labels[][32], double *temps, double *highs, double *crits, i
 int read_fans(fan_info_t *fans, int max);
 int read_ifaces(iface_t *ifs, int max);
 void read_disk_io(disk_io_t *dio);
-int read_procs_with_cpu(proc_info_t *procs, int max, unsigned long mem_total_kb,
-                        proc_info_t *prev, int prev_count);
-int proc_cmp_cpu(const void *a, const void *b);
-int proc_cmp_mem(const void *a, const void *b);
-int proc_cmp_pid(const void *a, const void *b);
+int read_loadavg(double *l1, double *l5, double *l15);
+int read_mounts(char mounts[][128], int max);
+int read_disk_usage(mount_usage_t *mounts, int max, int wait_ms);
+int read_procs_with_cpu(proc_table_t *pt, unsigned long mem_total_kb);
+int proc_table_copy(proc_table_t *dst, const proc_table_t *src);
+void proc_table_clear(proc_table_t *pt);
+int proc_table_push(proc_table_t *pt, int pid, double cpu, double mem, const char *name);
+void sort_procs(proc_table_t *pt, int sort, int k);
 battery_t read_battery(void);
-gpu_info_t read_gpu(void);
+int read_gpus(gpu_info_t *gpus, int max, int interval_ms, int wait_ms);
 int read_docker(docker_info_t *containers, int max);
+int read_irqs(irq_top_t *out);
+int read_psi(psi_t *out);
+int psi_trigger(int res, int stall_us, int window_us);
+
+extern const int hist_windows[HIST_NWINDOWS];
+extern const char *hist_window_names[HIST_NWINDOWS];
+int history_keyed(int kind, const char *key, int create);
+void history_add(int metric, time_t t, double v);
+void history_add_disks(const disk_io_t *dio, time_t t);
+void history_add_temps(const char labels[][32], const double *vals, int n, time_t t);
+void history_add_ifaces(const iface_t *ifs, int n, time_t t);
+void history_add_gpus(const gpu_info_t *gpus, int n, time_t t);
+int history_view(int metric, int window_s, int kind, double *out, int width);
+int history_default_path(char *buf, size_t sz);
+int history_open(const char *path);
+void history_close(void);
+void history_reset(void);
+void history_set_clock(time_t now);
+
+int record_open(const char *path);
+void record_sample(const sample_t *s);
+void record_close(void);
+int replay_open(const char *path);
+int replay_step(void);
+int replay_seek(double wall);
+double replay_next_wall(void);
+double replay_first_wall(void);
+sample_t *replay_sample(void);
+
+int serve_run(const char *addr);
+int json_run(int stream);
+
+uint64_t prof_clock(void);
+int prof_stage(const char *name);
+void prof_record(int stage, uint64_t ns);
+void prof_tick(void);
+int prof_count(void);
+int prof_quantiles(int stage, const char **name, unsigned *n, double *p50, double *p99);
+void prof_self(prof_self_t *out, double min_s);
+
+/* Times one statement into the named stage; the id is looked up once per call site. */
+#define PROF(name, stmt) do { \
+    static int prof_id_ = -1; \
+    if (prof_id_ < 0) prof_id_ = prof_stage(name); \
+    uint64_t prof_t0_ = prof_clock(); \
+    stmt; \
+    prof_record(prof_id_, prof_clock() - prof_t0_); \
+} while (0)
+
+int sampler_configure(const char *spec);
+int sampler_set_interval(int ms);
+int sampler_load_config(const char *path);
+int sampler_psi_trigger(const char *spec);
+int sampler_psi_open(int res, int *stall_ms, int *window_ms);
+int sampler_start(void);
+sample_t *sampler_acquire(int *fresh);
 
 void fmt_bytes(char *buf, size_t sz, double b);
 void fmt_speed(char *buf, size_t sz, double b);
+void fmt_ns(char *buf, size_t sz, double ns);
 
 int color_for_pct(double pct);
 void draw_bar(WINDOW *w, int y, int x, int width, double pct, int color);
-void draw_sparkline(WINDOW *w, int y, int x, double *data, int len, int pos, int total, int width);
+void draw_stacked_bar(WINDOW *w, int y, int x, int width, const float *pcts, int stride, const int *colors, int n);
+void draw_sparkline(WINDOW *w, int y, int x, const double *data, int len, int pos, int total, int width);
+void draw_history(WINDOW *w, int y, int x, int metric, int width);
 void draw_box(WINDOW *w, int y, int x, int h, int width, int color, const char *title);
-void draw_header(WINDOW *w, int cols, double cpu_avg, double mem_pct, int alert);
+void draw_header(WINDOW *w, int cols, const sample_t *s, int alert);
 void setup_theme(void);
 
-void draw_cpu_panel(int by, int top_h, int pw, double *core_pcts, double cpu_avg);
+void draw_cpu_panel(int by, int top_h, int pw, const sample_t *s);
 void draw_memory_panel(int by, int top_h, int px, int pw,
                        unsigned long mem_total, unsigned long mem_avail, unsigned long mem_used,
                        unsigned long mem_buf, unsigned long mem_cached,
@@ -155,13 +371,15 @@ void draw_memory_panel(int by, int top_h, int px, int pw,
 void draw_temps_panel(int by, int top_h, int px, int pw,
                       char t_labels[][32], double *t_vals, double *t_highs, int t_count,
                       fan_info_t *fans, int fan_count);
-void draw_gpu_panel(int by, int top_h, int px, int pw, gpu_info_t gpu);
-void draw_processes_panel(int bot_y, int bot_h, int pw,
-                          proc_info_t *procs, int nprocs);
-void draw_network_panel(int bot_y, int bot_h, int px, int pw,
-                        double total_rx_speed, double total_tx_speed);
-void draw_disk_panel(int bot_y, int bot_h, int px, int pw, int has_docker);
+void draw_gpu_panel(int by, int top_h, int px, int pw, const gpu_info_t *gpus, int count);
+void draw_irq_panel(int by, int top_h, int px, int pw, const sample_t *s);
+void draw_psi_panel(int by, int top_h, int px, int pw, const sample_t *s);
+int processes_panel_rows(int bot_h);
+void draw_processes_panel(int bot_y, int bot_h, int pw, const proc_table_t *pt);
+void draw_network_panel(int bot_y, int bot_h, int px, int pw, const sample_t *s);
+void draw_disk_panel(int bot_y, int bot_h, int px, int pw, const sample_t *s);
 void draw_docker_panel(int bot_y, int bot_h, int px, int pw,
                        docker_info_t *containers, int count);
+void draw_profile_overlay(int rows, int cols);
 
 #endif
@@ -5,6 +5,10 @@ const char *SPARK[] = {
     "\u2585", "\u2586", "\u2587", "\u2588"
 };
 
+const int cpu_state_colors[CPU_NSTATES] = { CLR_GREEN, CLR_RED, CLR_BLUE, CLR_YELLOW, CLR_MAGENTA, CLR_CYAN };
+const char *cpu_state_names[CPU_NSTATES] = { "user", "system", "iowait", "irq", "softirq", "steal" };
+const char *psi_names[PSI_NRES] = { "cpu", "memory", "io" };
+
 int color_for_pct(double pct) {
     if (pct < 50.0) return CLR_GREEN;
     if (pct < 80.0) return CLR_YELLOW;
@@ -25,7 +29,27 @@ void draw_bar(WINDOW *w, int y, int x, int width, double pct, int color) {
     wattroff(w, COLOR_PAIR(CLR_DIM) | COLOR_PAIR(color));
 }
 
-void draw_sparkline(WINDOW *w, int y, int x, double *data, int len, int pos, int total, int width) {
+/* Segment k covers pcts[k * stride]; each ends at the rounded running
+ * total, so rounding never pushes the bar past its width. */
+void draw_stacked_bar(WINDOW *w, int y, int x, int width, const float *pcts, int stride, const int *colors, int n) {
+    wmove(w, y, x);
+    double sum = 0;
+    int at = 0;
+    for (int k = 0; k < n; k++) {
+        sum += pcts[k * stride];
+        int end = (int)(sum / 100.0 * width + 0.5);
+        if (end > width) end = width;
+        if (end <= at) continue;
+        wattron(w, COLOR_PAIR(colors[k]) | A_BOLD);
+        for (; at < end; at++) wprintw(w, BAR_FULL);
+        wattroff(w, COLOR_PAIR(colors[k]) | A_BOLD);
+    }
+    wattron(w, COLOR_PAIR(CLR_DIM));
+    for (; at < width; at++) wprintw(w, BAR_DIM);
+    wattroff(w, COLOR_PAIR(CLR_DIM));
+}
+
+void draw_sparkline(WINDOW *w, int y, int x, const double *data, int len, int pos, int total, int width) {
     wmove(w, y, x);
     if (len < width) {
         wattron(w, COLOR_PAIR(CLR_DIM));
@@ -65,6 +89,20 @@ void fmt_speed(char *buf, size_t sz, double b) {
     snprintf(buf, sz, "%.1f %s", b, u[i]);
 }
 
+void fmt_ns(char *buf, size_t sz, double ns) {
+    if (ns < 1e3) snprintf(buf, sz, "%.0fns", ns);
+    else if (ns < 1e6) snprintf(buf, sz, "%.1fus", ns / 1e3);
+    else if (ns < 1e9) snprintf(buf, sz, "%.1fms", ns / 1e6);
+    else snprintf(buf, sz, "%.2fs", ns / 1e9);
+}
+
+void draw_history(WINDOW *w, int y, int x, int metric, int width) {
+    double buf[HISTORY_LEN];
+    if (width > HISTORY_LEN) width = HISTORY_LEN;
+    int n = history_view(metric, hist_windows[g_window], HIST_MEAN, buf, width);
+    draw_sparkline(w, y, x, buf, n, n, width, width);
+}
+
 void draw_box(WINDOW *w, int y, int x, int h, int width, int color, const char *title) {
     if (h < 2 || width < 2) return;
     wattron(w, COLOR_PAIR(color));
@@ -126,16 +164,16 @@ void setup_theme(void) {
     }
 }
 
-void draw_header(WINDOW *w, int cols, double cpu_avg, double mem_pct, int alert) {
-    time_t now = time(NULL);
+void draw_header(WINDOW *w, int cols, const sample_t *s, int alert) {
+    time_t now = (time_t)s->wall;
     struct tm *tm = localtime(&now);
     char timebuf[64];
     strftime(timebuf, sizeof(timebuf), "%a %b %d  %H:%M:%S", tm);
-    struct sysinfo si;
-    sysinfo(&si);
-    int days = si.uptime / 86400;
-    int hours = (si.uptime % 86400) / 3600;
-    int mins = (si.uptime % 3600) / 60;
+    double cpu_avg = s->cpu_avg;
+    double mem_pct = (s->mem_total > 0) ? (double)s->mem_used / s->mem_total * 100.0 : 0;
+    int days = s->uptime / 86400;
+    int hours = (s->uptime % 86400) / 3600;
+    int mins = (s->uptime % 3600) / 60;
 
     if (alert && g_alert_flash) {
         wattron(w, COLOR_PAIR(CLR_ALERT) | A_BOLD | A_BLINK);
@@ -160,6 +198,13 @@ void draw_header(WINDOW *w, int cols, double cpu_avg, double mem_pct, int alert)
 
     const char *sort_labels[] = {"cpu", "mem", "pid"};
     wattron(w, COLOR_PAIR(CLR_DIM));
-    mvwprintw(w, 0, cols - 40, "sort:%s  t:theme  q:exit ", sort_labels[g_sort]);
+    if (g_status) {
+        wattroff(w, COLOR_PAIR(CLR_DIM));
+        wattron(w, COLOR_PAIR(CLR_MAGENTA) | A_BOLD);
+        mvwprintw(w, 0, cols - 50 - (int)strlen(g_status), "%s", g_status);
+        wattroff(w, COLOR_PAIR(CLR_MAGENTA) | A_BOLD);
+        wattron(w, COLOR_PAIR(CLR_DIM));
+    }
+    mvwprintw(w, 0, cols - 48, "sort:%s  w:%-3s  t:theme  q:exit ", sort_labels[g_sort], hist_window_names[g_window]);
     wattroff(w, COLOR_PAIR(CLR_DIM) | COLOR_PAIR(CLR_HEADER) | COLOR_PAIR(CLR_ALERT));
 }
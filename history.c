@@ -0,0 +1,293 @@
+#include "cutedash.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+typedef struct {
+    float min, max, sum;
+    uint32_t n;
+} hist_bucket_t;
+
+/* Every sample lands in all three tiers at once, so the coarse tiers keep
+ * exact min/max/mean without re-aggregating the fine ones. */
+static const struct { int step, len, off; } tiers[HIST_TIERS] = {
+    {  1,   600,    0 },
+    { 10,  2160,  600 },
+    { 60, 10080, 2760 },
+};
+#define HIST_BUCKETS (600 + 2160 + 10080)
+
+typedef struct {
+    int64_t head[HIST_TIERS];
+    hist_bucket_t b[HIST_BUCKETS];
+} hist_series_t;
+
+/* Per-device series live in a fixed pool after the system-wide ones, keyed
+ * by kind and name; a device that comes back finds its old slot. When the
+ * pool is full the slot written least recently is reused, but only once it
+ * has been idle for the whole fine tier, so a machine with more devices
+ * than slots keeps the first ones rather than churning through all. */
+#define HIST_SLOTS 96
+#define HIST_SERIES (HIST_COUNT + HIST_SLOTS)
+
+typedef struct {
+    char key[32];
+    uint32_t kind, used;
+} hist_slot_t;
+
+#define HIST_MAGIC "CDHIST1"
+#define HIST_VERSION 2
+
+/* On-disk layout is the in-memory layout: the file is mapped and the
+ * rings are written in place, so opening it costs the same at any age. */
+typedef struct {
+    char magic[8];
+    uint32_t version, metrics, slots, tiers, bucket_size;
+    uint32_t steps[HIST_TIERS], lens[HIST_TIERS];
+    uint64_t size;
+} hist_header_t;
+
+typedef struct {
+    hist_header_t h;
+    hist_slot_t slot[HIST_SLOTS];
+    hist_series_t s[HIST_SERIES];
+} hist_file_t;
+
+static hist_series_t fallback[HIST_SERIES];
+static hist_slot_t fallback_slots[HIST_SLOTS];
+static hist_series_t *series = fallback;
+static hist_slot_t *slots = fallback_slots;
+static hist_file_t *hist_map;
+static int hist_fd = -1;
+static pthread_mutex_t hist_mu = PTHREAD_MUTEX_INITIALIZER;
+static time_t hist_clock;
+
+const int hist_windows[HIST_NWINDOWS] = { 120, 600, 3600, 21600, 86400, 604800 };
+const char *hist_window_names[HIST_NWINDOWS] = { "2m", "10m", "1h", "6h", "24h", "7d" };
+
+static void bucket_clear(hist_bucket_t *b) {
+    b->min = b->max = b->sum = 0;
+    b->n = 0;
+}
+
+/* Returns the series for kind/key, claiming a slot when create is set,
+ * or -1. */
+int history_keyed(int kind, const char *key, int create) {
+    int found = -1, lru = 0;
+    pthread_mutex_lock(&hist_mu);
+    for (int i = 0; i < HIST_SLOTS && found < 0; i++) {
+        const hist_slot_t *sl = &slots[i];
+        if (sl->used && sl->kind == (uint32_t)kind && strncmp(sl->key, key, sizeof(sl->key)) == 0) found = i;
+        else if (slots[lru].used && (!sl->used || series[HIST_COUNT + i].head[0] < series[HIST_COUNT + lru].head[0])) lru = i;
+    }
+    int64_t idle = (int64_t)(hist_clock ? hist_clock : time(NULL)) - tiers[0].len;
+    if (found < 0 && create && (!slots[lru].used || series[HIST_COUNT + lru].head[0] < idle)) {
+        found = lru;
+        hist_slot_t *sl = &slots[found];
+        memset(&series[HIST_COUNT + found], 0, sizeof(hist_series_t));
+        memset(sl, 0, sizeof(*sl));
+        snprintf(sl->key, sizeof(sl->key), "%s", key);
+        sl->kind = (uint32_t)kind;
+        sl->used = 1;
+    }
+    pthread_mutex_unlock(&hist_mu);
+    return found < 0 ? -1 : HIST_COUNT + found;
+}
+
+void history_add(int metric, time_t t, double v) {
+    if (metric < 0 || metric >= HIST_SERIES) return;
+    pthread_mutex_lock(&hist_mu);
+    hist_series_t *s = &series[metric];
+    for (int k = 0; k < HIST_TIERS; k++) {
+        int64_t bn = (int64_t)t / tiers[k].step;
+        hist_bucket_t *ring = s->b + tiers[k].off;
+        if (s->head[k] == 0 || bn - s->head[k] >= tiers[k].len) {
+            for (int i = 0; i < tiers[k].len; i++) bucket_clear(&ring[i]);
+            s->head[k] = bn;
+        } else if (bn > s->head[k]) {
+            for (int64_t j = s->head[k] + 1; j <= bn; j++) bucket_clear(&ring[j % tiers[k].len]);
+            s->head[k] = bn;
+        } else if (bn <= s->head[k] - tiers[k].len) {
+            continue;
+        }
+        hist_bucket_t *b = &ring[bn % tiers[k].len];
+        float fv = (float)v;
+        if (b->n == 0 || fv < b->min) b->min = fv;
+        if (b->n == 0 || fv > b->max) b->max = fv;
+        b->sum += fv;
+        b->n++;
+    }
+    pthread_mutex_unlock(&hist_mu);
+}
+
+static void add_keyed(int kind, const char *key, time_t t, double v) {
+    history_add(history_keyed(kind, key, 1), t, v);
+}
+
+void history_add_disks(const disk_io_t *dio, time_t t) {
+    for (int i = 0; i < dio->ndev; i++) {
+        const disk_dev_t *d = &dio->dev[i];
+        add_keyed(HKEY_DISK_UTIL, d->name, t, d->util);
+        add_keyed(HKEY_DISK_IOPS, d->name, t, d->read_iops + d->write_iops);
+    }
+}
+
+void history_add_temps(const char labels[][32], const double *vals, int n, time_t t) {
+    for (int i = 0; i < n; i++) add_keyed(HKEY_TEMP, labels[i], t, vals[i]);
+}
+
+void history_add_ifaces(const iface_t *ifs, int n, time_t t) {
+    for (int i = 0; i < n; i++) {
+        add_keyed(HKEY_IFACE_RX, ifs[i].name, t, ifs[i].rx_speed);
+        add_keyed(HKEY_IFACE_TX, ifs[i].name, t, ifs[i].tx_speed);
+    }
+}
+
+/* GPUs are keyed by index; a stale row repeats old values, so it is skipped. */
+void history_add_gpus(const gpu_info_t *gpus, int n, time_t t) {
+    for (int i = 0; i < n; i++) {
+        const gpu_info_t *g = &gpus[i];
+        if (g->stale) continue;
+        char key[16];
+        snprintf(key, sizeof(key), "%d", g->index);
+        add_keyed(HKEY_GPU_UTIL, key, t, g->gpu_util);
+        if (g->mem_total_mb > 0) add_keyed(HKEY_GPU_MEM, key, t, (double)g->mem_used_mb / g->mem_total_mb * 100.0);
+        add_keyed(HKEY_GPU_TEMP, key, t, g->temp);
+    }
+}
+
+/* Fills out[] oldest first with width points covering the last window_s
+ * seconds, from the finest tier that spans the window. Leading points with
+ * no data are dropped, so the return value may be less than width. */
+int history_view(int metric, int window_s, int kind, double *out, int width) {
+    if (metric < 0 || metric >= HIST_SERIES || width <= 0) return 0;
+    int k = 0;
+    while (k < HIST_TIERS - 1 && tiers[k].step * tiers[k].len < window_s) k++;
+    int64_t step = tiers[k].step, len = tiers[k].len;
+    int64_t newest = (int64_t)(hist_clock ? hist_clock : time(NULL)) / step;
+    int64_t oldest = newest - (window_s + step - 1) / step + 1;
+    int count = 0;
+
+    pthread_mutex_lock(&hist_mu);
+    const hist_series_t *s = &series[metric];
+    const hist_bucket_t *ring = s->b + tiers[k].off;
+    if (s->head[k] == 0) { pthread_mutex_unlock(&hist_mu); return 0; }
+    if (oldest <= s->head[k] - len) oldest = s->head[k] - len + 1;
+    double per = (double)(newest - oldest + 1) / width;
+    for (int i = 0; i < width; i++) {
+        int64_t b0 = oldest + (int64_t)(i * per), b1 = oldest + (int64_t)((i + 1) * per);
+        if (b1 <= b0) b1 = b0 + 1;
+        double sum = 0, mn = INFINITY, mx = -INFINITY;
+        uint32_t n = 0;
+        for (int64_t j = b0; j < b1 && j <= s->head[k]; j++) {
+            const hist_bucket_t *b = &ring[j % len];
+            if (!b->n) continue;
+            sum += b->sum;
+            n += b->n;
+            if (b->min < mn) mn = b->min;
+            if (b->max > mx) mx = b->max;
+        }
+        if (!n) {
+            if (count) { out[count] = out[count - 1]; count++; }
+            continue;
+        }
+        out[count++] = kind == HIST_MIN ? mn : kind == HIST_MAX ? mx : sum / n;
+    }
+    pthread_mutex_unlock(&hist_mu);
+    return count;
+}
+
+static void header_fill(hist_header_t *h) {
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, HIST_MAGIC, sizeof(h->magic));
+    h->version = HIST_VERSION;
+    h->metrics = HIST_COUNT;
+    h->slots = HIST_SLOTS;
+    h->tiers = HIST_TIERS;
+    h->bucket_size = sizeof(hist_bucket_t);
+    for (int k = 0; k < HIST_TIERS; k++) {
+        h->steps[k] = tiers[k].step;
+        h->lens[k] = tiers[k].len;
+    }
+    h->size = sizeof(hist_file_t);
+}
+
+int history_default_path(char *buf, size_t sz) {
+    const char *xdg = getenv("XDG_STATE_HOME"), *home = getenv("HOME");
+    char dir[512];
+    if (xdg && *xdg) snprintf(dir, sizeof(dir), "%s", xdg);
+    else if (home && *home) snprintf(dir, sizeof(dir), "%s/.local/state", home);
+    else return -1;
+    for (char *p = dir + 1; ; p++) {
+        if (*p == '/' || !*p) {
+            char c = *p;
+            *p = 0;
+            if (mkdir(dir, 0755) != 0 && errno != EEXIST) return -1;
+            if (!(*p = c)) break;
+        }
+    }
+    if ((size_t)snprintf(buf, sz, "%s/cutedash", dir) >= sz) return -1;
+    if (mkdir(buf, 0700) != 0 && errno != EEXIST) return -1;
+    return (size_t)snprintf(buf, sz, "%s/cutedash/history", dir) < sz ? 0 : -1;
+}
+
+/* A file with a different header is reset rather than migrated. A second
+ * instance that can't take the lock maps the file copy-on-write, so it
+ * starts with the saved history but never writes back. */
+int history_open(const char *path) {
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) return -1;
+    int shared = flock(fd, LOCK_EX | LOCK_NB) == 0;
+    hist_header_t want, have;
+    header_fill(&want);
+    struct stat st;
+    int valid = fstat(fd, &st) == 0 && (uint64_t)st.st_size == want.size &&
+                pread(fd, &have, sizeof(have), 0) == (ssize_t)sizeof(have) &&
+                memcmp(&have, &want, sizeof(want)) == 0;
+    if (!valid) {
+        if (!shared || ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)want.size) != 0 ||
+            pwrite(fd, &want, sizeof(want), 0) != (ssize_t)sizeof(want)) {
+            close(fd);
+            return -1;
+        }
+    }
+    void *m = mmap(NULL, sizeof(hist_file_t), PROT_READ | PROT_WRITE,
+                   shared ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    if (m == MAP_FAILED) { close(fd); return -1; }
+    pthread_mutex_lock(&hist_mu);
+    hist_fd = fd;
+    hist_map = m;
+    series = hist_map->s;
+    slots = hist_map->slot;
+    pthread_mutex_unlock(&hist_mu);
+    return 0;
+}
+
+void history_close(void) {
+    pthread_mutex_lock(&hist_mu);
+    if (hist_map) {
+        series = fallback;
+        slots = fallback_slots;
+        munmap(hist_map, sizeof(hist_file_t));
+        close(hist_fd);
+        hist_map = NULL;
+        hist_fd = -1;
+    }
+    pthread_mutex_unlock(&hist_mu);
+}
+
+void history_reset(void) {
+    pthread_mutex_lock(&hist_mu);
+    memset(series, 0, HIST_SERIES * sizeof(hist_series_t));
+    memset(slots, 0, HIST_SLOTS * sizeof(hist_slot_t));
+    pthread_mutex_unlock(&hist_mu);
+}
+
+/* Replay renders history relative to the recording's clock, not now. */
+void history_set_clock(time_t now) {
+    hist_clock = now;
+}
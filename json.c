@@ -0,0 +1,293 @@
+#include "cutedash.h"
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+
+/* NDJSON output. Each sample is serialized into one static buffer with
+ * hand-rolled number formatting and written with a single write(). */
+#define JSON_BUF (256 * 1024)
+#define JSON_TOP_PROCS 10
+#define JSON_DEPTH 8
+
+static char jbuf[JSON_BUF];
+static size_t jlen;
+static int jfirst[JSON_DEPTH], jdepth;
+
+static void j_raw(const char *s, size_t n) {
+    if (jlen + n > JSON_BUF) n = JSON_BUF - jlen;
+    memcpy(jbuf + jlen, s, n);
+    jlen += n;
+}
+
+static void j_char(char c) {
+    if (jlen < JSON_BUF) jbuf[jlen++] = c;
+}
+
+static void j_sep(void) {
+    if (!jfirst[jdepth]) j_char(',');
+    jfirst[jdepth] = 0;
+}
+
+static void j_open(char c) {
+    j_char(c);
+    if (jdepth < JSON_DEPTH - 1) jfirst[++jdepth] = 1;
+}
+
+static void j_close(char c) {
+    j_char(c);
+    if (jdepth > 0) jdepth--;
+}
+
+static void j_str(const char *s) {
+    static const char hex[] = "0123456789abcdef";
+    j_char('"');
+    for (; *s; s++) {
+        unsigned char ch = (unsigned char)*s;
+        if (ch == '"' || ch == '\\') { j_char('\\'); j_char((char)ch); }
+        else if (ch == '\n') j_raw("\\n", 2);
+        else if (ch == '\t') j_raw("\\t", 2);
+        else if (ch < 0x20) { j_raw("\\u00", 4); j_char(hex[ch >> 4]); j_char(hex[ch & 15]); }
+        else j_char((char)ch);
+    }
+    j_char('"');
+}
+
+static void j_u64(uint64_t v) {
+    char tmp[20];
+    int n = 0;
+    do { tmp[n++] = (char)('0' + v % 10); v /= 10; } while (v);
+    while (n) j_char(tmp[--n]);
+}
+
+static void j_i64(int64_t v) {
+    if (v < 0) { j_char('-'); j_u64(-(uint64_t)v); }
+    else j_u64((uint64_t)v);
+}
+
+/* Fixed-point with dec (0-3) decimals; NaN and infinities become null. */
+static void j_fix(double v, int dec) {
+    static const int scale[] = { 1, 10, 100, 1000 };
+    if (!isfinite(v) || fabs(v) > 9e15 / scale[dec]) { j_raw("null", 4); return; }
+    int64_t x = llround(v * scale[dec]);
+    if (x < 0) { j_char('-'); x = -x; }
+    j_u64((uint64_t)(x / scale[dec]));
+    if (!dec) return;
+    j_char('.');
+    int64_t frac = x % scale[dec];
+    for (int d = scale[dec] / 10; d; d /= 10) { j_char((char)('0' + frac / d)); frac %= d; }
+}
+
+static void j_key(const char *k) {
+    j_sep();
+    j_str(k);
+    j_char(':');
+}
+
+#define J_INT(k, v) do { j_key(k); j_i64((int64_t)(v)); } while (0)
+#define J_FIX(k, v, d) do { j_key(k); j_fix(v, d); } while (0)
+#define J_STR(k, v) do { j_key(k); j_str(v); } while (0)
+
+static void json_irq_srcs(const char *k, const irq_src_t *src, int n) {
+    j_key(k); j_open('[');
+    for (int i = 0; i < n; i++) {
+        j_sep(); j_open('{');
+        J_STR("name", src[i].name); J_FIX("rate", src[i].rate, 1); J_INT("ncpus", src[i].ncpus);
+        j_key("cpus"); j_open('{');
+        for (int c = 0; c < IRQ_TOP_CPUS && src[i].cpu[c] >= 0; c++) {
+            char id[12];
+            snprintf(id, sizeof(id), "%d", src[i].cpu[c]);
+            J_FIX(id, src[i].cpu_rate[c], 1);
+        }
+        j_close('}');
+        j_close('}');
+    }
+    j_close(']');
+}
+
+static void json_sample(sample_t *s) {
+    jlen = 0;
+    jdepth = 0;
+    jfirst[0] = 1;
+    j_open('{');
+    J_FIX("ts", s->wall, 3);
+
+    j_key("cpu"); j_open('{');
+    J_FIX("avg", s->cpu_avg, 2);
+    j_key("cores"); j_open('[');
+    for (int i = 0; i < s->num_cores; i++) { j_sep(); j_fix(s->core_pcts[i], 2); }
+    j_close(']');
+    j_key("states"); j_open('{');
+    for (int k = 0; k < CPU_NSTATES; k++) J_FIX(cpu_state_names[k], s->cpu_state[k], 2);
+    j_close('}');
+    j_key("core_states"); j_open('{');
+    for (int k = 0; k < CPU_NSTATES; k++) {
+        j_key(cpu_state_names[k]); j_open('[');
+        for (int i = 0; i < s->num_cores; i++) { j_sep(); j_fix(s->core_state[k][i], 2); }
+        j_close(']');
+    }
+    j_close('}');
+    j_key("load"); j_open('[');
+    j_sep(); j_fix(s->load1, 2); j_sep(); j_fix(s->load5, 2); j_sep(); j_fix(s->load15, 2);
+    j_close(']');
+    j_close('}');
+
+    j_key("interrupts"); j_open('{');
+    J_FIX("rate", s->irq.hard_rate, 1); J_FIX("softirq_rate", s->irq.soft_rate, 1);
+    json_irq_srcs("top", s->irq.hard, s->irq.nhard);
+    json_irq_srcs("softirq_top", s->irq.soft, s->irq.nsoft);
+    j_close('}');
+
+    j_key("mem"); j_open('{');
+    J_INT("total", s->mem_total * 1024); J_INT("available", s->mem_avail * 1024);
+    J_INT("used", s->mem_used * 1024); J_INT("buffers", s->mem_buf * 1024);
+    J_INT("cached", s->mem_cached * 1024);
+    J_INT("swap_total", s->sw_total * 1024); J_INT("swap_free", s->sw_free * 1024);
+    j_close('}');
+
+    j_key("pressure"); j_open('{');
+    for (int r = 0; r < PSI_NRES; r++) {
+        const psi_t *p = &s->psi[r];
+        if (!p->present) continue;
+        j_key(psi_names[r]); j_open('{');
+        j_key("some"); j_open('{');
+        J_FIX("avg10", p->some[0], 2); J_FIX("avg60", p->some[1], 2); J_FIX("avg300", p->some[2], 2);
+        J_FIX("rate", p->some_rate, 2); J_INT("total_us", p->some_total);
+        j_close('}');
+        j_key("full"); j_open('{');
+        J_FIX("avg10", p->full[0], 2); J_FIX("avg60", p->full[1], 2); J_FIX("avg300", p->full[2], 2);
+        J_FIX("rate", p->full_rate, 2); J_INT("total_us", p->full_total);
+        j_close('}');
+        if (p->trig_window_ms) {
+            J_INT("trigger_stall_ms", p->trig_stall_ms); J_INT("trigger_window_ms", p->trig_window_ms);
+            J_INT("trigger_events", p->events); if (p->events) J_FIX("last_event", p->event_wall, 3);
+        }
+        j_close('}');
+    }
+    j_close('}');
+
+    j_key("temps"); j_open('[');
+    for (int i = 0; i < s->t_count; i++) {
+        j_sep(); j_open('{');
+        J_STR("label", s->t_labels[i]); J_FIX("c", s->t_vals[i], 1);
+        if (s->t_highs[i] > 0) J_FIX("high", s->t_highs[i], 1);
+        if (s->t_crits[i] > 0) J_FIX("crit", s->t_crits[i], 1);
+        j_close('}');
+    }
+    j_close(']');
+
+    j_key("ifaces"); j_open('[');
+    for (int i = 0; i < s->num_ifaces; i++) {
+        const iface_t *f = &s->ifaces[i];
+        j_sep(); j_open('{');
+        J_STR("name", f->name); J_INT("rx", f->rx); J_INT("tx", f->tx);
+        J_FIX("rx_bps", f->rx_speed, 0); J_FIX("tx_bps", f->tx_speed, 0);
+        j_close('}');
+    }
+    j_close(']');
+
+    const disk_io_t *dio = &s->disk_io;
+    j_key("disk"); j_open('{');
+    J_FIX("read_bps", dio->read_speed, 0); J_FIX("write_bps", dio->write_speed, 0);
+    j_key("devices"); j_open('[');
+    for (int i = 0; i < dio->ndev; i++) {
+        const disk_dev_t *d = &dio->dev[i];
+        j_sep(); j_open('{');
+        J_STR("name", d->name);
+        J_FIX("r_iops", d->read_iops, 1); J_FIX("w_iops", d->write_iops, 1);
+        J_FIX("r_bps", d->read_bps, 0); J_FIX("w_bps", d->write_bps, 0);
+        J_FIX("util", d->util, 1); J_FIX("await_ms", d->await_ms, 2); J_FIX("queue", d->queue, 2);
+        j_close('}');
+    }
+    j_close(']');
+    j_key("mounts"); j_open('[');
+    for (int i = 0; i < s->mount_count; i++) {
+        const mount_usage_t *m = &s->mounts[i];
+        if (!m->unresponsive && m->total <= 0) continue;
+        j_sep(); j_open('{');
+        J_STR("path", m->path);
+        if (m->unresponsive) { j_key("unresponsive"); j_raw("true", 4); }
+        else { J_FIX("used", m->used, 0); J_FIX("total", m->total, 0); }
+        j_close('}');
+    }
+    j_close(']');
+    j_close('}');
+
+    j_key("procs"); j_open('{');
+    J_INT("count", s->procs.count);
+    sort_procs(&s->procs, SORT_CPU, JSON_TOP_PROCS);
+    j_key("top"); j_open('[');
+    for (int i = 0; i < s->procs.ntop; i++) {
+        uint32_t r = s->procs.order[i];
+        j_sep(); j_open('{');
+        J_INT("pid", s->procs.pid[r]); J_STR("name", PROC_NAME(&s->procs, r));
+        J_FIX("cpu", s->procs.cpu_pct[r], 2); J_FIX("mem", s->procs.mem_pct[r], 2);
+        j_close('}');
+    }
+    j_close(']');
+    j_close('}');
+
+    j_key("containers"); j_open('[');
+    for (int i = 0; i < s->docker_count; i++) {
+        const docker_info_t *d = &s->docker[i];
+        j_sep(); j_open('{');
+        J_STR("name", d->name); J_STR("id", d->id); J_STR("status", d->status);
+        J_FIX("cpu", d->cpu_pct, 2); J_FIX("mem_mb", d->mem_mb, 1); J_INT("pids", d->pids);
+        J_FIX("io_read_bps", d->io_read_bps, 0); J_FIX("io_write_bps", d->io_write_bps, 0);
+        j_close('}');
+    }
+    j_close(']');
+
+    if (s->gpu_count) {
+        j_key("gpus"); j_open('[');
+        for (int i = 0; i < s->gpu_count; i++) {
+            const gpu_info_t *g = &s->gpus[i];
+            j_sep(); j_open('{');
+            J_INT("index", g->index); J_STR("name", g->name); J_INT("util", g->gpu_util);
+            J_INT("temp", g->temp); J_INT("mem_used_mb", g->mem_used_mb); J_INT("power_w", g->power_w);
+            if (g->stale) { j_key("stale"); j_raw("true", 4); }
+            j_close('}');
+        }
+        j_close(']');
+    }
+    j_close('}');
+    if (jlen == JSON_BUF) jlen--;
+    j_char('\n');
+}
+
+static int write_all(int fd, const char *p, size_t n) {
+    while (n) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return -1;
+        p += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+static volatile sig_atomic_t json_stop;
+static void json_signal(int sig) { (void)sig; json_stop = 1; }
+
+/* --json prints the first complete sample; --stream prints one per sample. */
+int json_run(int stream) {
+    signal(SIGPIPE, SIG_IGN);
+    int wake_fd = sampler_start();
+    if (wake_fd < 0) { perror("cutedash: sampler"); return 1; }
+    struct sigaction sa = { .sa_handler = json_signal };
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    struct pollfd pfd = { .fd = wake_fd, .events = POLLIN };
+    while (!json_stop) {
+        if (poll(&pfd, 1, -1) < 0) {
+            if (errno == EINTR) continue;
+            return 1;
+        }
+        int fresh;
+        sample_t *s = sampler_acquire(&fresh);
+        if (!fresh || !s->valid) continue;
+        json_sample(s);
+        if (write_all(STDOUT_FILENO, jbuf, jlen) != 0) return errno == EPIPE ? 0 : 1;
+        if (!stream) return 0;
+    }
+    return 0;
+}
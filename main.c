@@ -1,41 +1,76 @@
 #include "cutedash.h"
+#include <errno.h>
+#include <poll.h>
 
 int g_theme = THEME_DEFAULT;
 int g_sort = SORT_CPU;
 int g_once = 0;
 int g_alert_cpu = 90;
 int g_alert_temp = 85;
+int g_alert_psi = 25;
 int g_alert_flash = 0;
+int g_scan_workers = 0;
+int g_disk_parts = 0;
+int g_window = 0;
+int g_profile = 0;
+int g_cpu_heatmap = 0;
+int g_irq_panel = 0;
+int g_psi_panel = 0;
+const char *g_proc_root = "/proc";
+const char *g_sys_root = "/sys";
+const char *g_cgroup_root = NULL;
+const char *g_docker_root = "/var/lib/docker";
+const char *g_status = NULL;
 volatile int g_resize = 0;
 
-cpu_stat_t prev_cpu[MAX_CORES + 1];
-int num_cores = 0;
-double cpu_history[HISTORY_LEN];
-int cpu_hist_len = 0, cpu_hist_pos = 0;
-
-iface_t ifaces[MAX_IFACES];
-int num_ifaces = 0;
-double net_rx_hist[HISTORY_LEN], net_tx_hist[HISTORY_LEN];
-int net_hist_len = 0, net_hist_pos = 0;
-
-disk_io_t disk_io = {0};
+static void handle_resize(int sig) { (void)sig; g_resize = 1; }
 
-proc_info_t prev_procs[MAX_PROCS];
-int prev_nprocs = 0;
+static void print_irq_srcs(const char *kind, const irq_src_t *src, int n) {
+    for (int i = 0; i < n && i < 5; i++) {
+        printf("  %-7s %-32.32s %10.0f/s ", kind, src[i].name, src[i].rate);
+        int k = 0;
+        for (; k < IRQ_TOP_CPUS && src[i].cpu[k] >= 0; k++)
+            printf(" cpu%d %.0f%%", src[i].cpu[k], src[i].cpu_rate[k] / src[i].rate * 100.0);
+        if (src[i].ncpus > k) printf(" +%d", src[i].ncpus - k);
+        printf("\n");
+    }
+}
 
-static void handle_resize(int sig) { (void)sig; g_resize = 1; }
+static void print_psi(const psi_t *psi) {
+    printf("  %-7s %-5s %7s %7s %7s %7s\n", "RES", "KIND", "NOW", "AVG10", "AVG60", "AVG300");
+    for (int r = 0; r < PSI_NRES; r++) {
+        const psi_t *p = &psi[r];
+        if (!p->present) continue;
+        printf("  %-7s %-5s %6.2f%% %6.2f%% %6.2f%% %6.2f%%\n", psi_names[r], "some", p->some_rate, p->some[0], p->some[1], p->some[2]);
+        if (r != PSI_CPU || p->full_total)
+            printf("  %-7s %-5s %6.2f%% %6.2f%% %6.2f%% %6.2f%%\n", "", "full", p->full_rate, p->full[0], p->full[1], p->full[2]);
+    }
+}
 
 static void print_snapshot(void) {
-    read_cpu_stats(prev_cpu, &num_cores);
-    num_cores--;
+    docker_info_t dk[MAX_DOCKER];
+    irq_top_t irq;
+    psi_t psi[PSI_NRES] = {{0}};
+    prof_self_t self;
+    prof_self(&self, 0);
+    PROF("cpu", read_cpu_stats(&prev_cpu));
+    num_cores = prev_cpu.count > 1 ? prev_cpu.count - 1 : 0;
+    PROF("docker", read_docker(dk, MAX_DOCKER));
+    PROF("disk", read_disk_io(&disk_io));
+    PROF("irq", read_irqs(&irq));
+    PROF("psi", read_psi(psi));
     usleep(500000);
-    cpu_stat_t cur_cpu[MAX_CORES + 1];
-    int cur_count;
-    read_cpu_stats(cur_cpu, &cur_count);
-    double cpu_avg = calc_cpu_pct(&cur_cpu[0], &prev_cpu[0]);
+    cpu_stat_t cur_cpu = {0};
+    PROF("cpu", read_cpu_stats(&cur_cpu));
+    double *pct = calloc(num_cores + 1, sizeof(double));
+    float *state = calloc((size_t)CPU_NSTATES * (num_cores + 1), sizeof(float));
+    if (!pct || !state) return;
+    if (num_cores && cpu_stat_match(&cur_cpu, &prev_cpu))
+        calc_cpu_pct(&cur_cpu, &prev_cpu, 0, num_cores + 1, pct, state, num_cores + 1);
+    double cpu_avg = pct[0];
 
     unsigned long mt = 0, ma = 0, mu = 0, mb = 0, mc = 0, st = 0, sf = 0;
-    read_mem(&mt, &ma, &mu, &mb, &mc, &st, &sf);
+    PROF("mem", read_mem(&mt, &ma, &mu, &mb, &mc, &st, &sf));
     double mem_pct = (mt > 0) ? (double)mu / mt * 100.0 : 0;
 
     struct sysinfo si;
@@ -49,11 +84,16 @@ static void print_snapshot(void) {
 
     printf("-- CPU --\n");
     for (int i = 0; i < num_cores; i++)
-        printf("  Core %d: %5.1f%%\n", i, calc_cpu_pct(&cur_cpu[i + 1], &prev_cpu[i + 1]));
+        printf("  Core %d: %5.1f%%\n", i, pct[i + 1]);
     printf("  Average: %.1f%%\n", cpu_avg);
+    printf("  States:");
+    for (int k = 0; k < CPU_NSTATES; k++) printf(" %s %.1f%%", cpu_state_names[k], state[k * (num_cores + 1)]);
+    printf("\n");
+    free(pct);
+    free(state);
+    free(cur_cpu.arena);
     double l1, l5, l15;
-    FILE *lf = fopen("/proc/loadavg", "r");
-    if (lf) { (void)fscanf(lf, "%lf %lf %lf", &l1, &l5, &l15); fclose(lf); printf("  Load: %.2f / %.2f / %.2f\n", l1, l5, l15); }
+    if (read_loadavg(&l1, &l5, &l15)) printf("  Load: %.2f / %.2f / %.2f\n", l1, l5, l15);
 
     printf("\n-- MEMORY --\n");
     printf("  Used: %.1f / %.1f GB (%.1f%%)\n", mu / 1048576.0, mt / 1048576.0, mem_pct);
@@ -62,61 +102,119 @@ static void print_snapshot(void) {
     if (st > 0) printf("  Swap: %.1f / %.1f GB\n", (st - sf) / 1048576.0, st / 1048576.0);
 
     char t_labels[32][32]; double t_vals[32], t_highs[32], t_crits[32];
-    int tc = read_temps(t_labels, t_vals, t_highs, t_crits, 32);
+    int tc;
+    PROF("temps", tc = read_temps(t_labels, t_vals, t_highs, t_crits, 32));
     if (tc > 0) {
         printf("\n-- TEMPS --\n");
         for (int i = 0; i < tc; i++) printf("  %-16s %4.0f\u00b0C\n", t_labels[i], t_vals[i]);
     }
 
     fan_info_t fans[16];
-    int fc = read_fans(fans, 16);
+    int fc;
+    PROF("fans", fc = read_fans(fans, 16));
     if (fc > 0) {
         printf("\n-- FANS --\n");
         for (int i = 0; i < fc; i++) printf("  %-16s %d RPM\n", fans[i].label, fans[i].rpm);
     }
 
-    gpu_info_t gpu = read_gpu();
-    if (gpu.has_gpu) {
-        printf("\n-- GPU --\n");
-        printf("  %s\n", gpu.name);
-        printf("  Util: %d%%  Mem: %d/%d MB  Temp: %d\u00b0C", gpu.gpu_util, gpu.mem_used_mb, gpu.mem_total_mb, gpu.temp);
-        if (gpu.power_w > 0) printf("  Power: %dW/%dW", gpu.power_w, gpu.power_max_w);
+    gpu_info_t gpus[MAX_GPUS];
+    int gc;
+    PROF("gpu", gc = read_gpus(gpus, MAX_GPUS, REFRESH_MS, 2000));
+    if (gc > 0) printf("\n-- GPU --\n");
+    for (int i = 0; i < gc; i++) {
+        printf("  [%d] %s\n", gpus[i].index, gpus[i].name);
+        printf("  Util: %d%%  Mem: %d/%d MB  Temp: %d\u00b0C", gpus[i].gpu_util, gpus[i].mem_used_mb, gpus[i].mem_total_mb, gpus[i].temp);
+        if (gpus[i].power_w > 0) printf("  Power: %dW/%dW", gpus[i].power_w, gpus[i].power_max_w);
         printf("\n");
     }
 
-    battery_t bat = read_battery();
+    battery_t bat;
+    PROF("battery", bat = read_battery());
     if (bat.present) printf("\n-- BATTERY --\n  %d%% (%s)\n", bat.capacity, bat.status);
 
     printf("\n-- DISK --\n");
-    FILE *mf = fopen("/proc/mounts", "r");
-    if (mf) {
-        char mline[512];
-        while (fgets(mline, sizeof(mline), mf)) {
-            char dev[128], mount[128];
-            sscanf(mline, "%127s %127s", dev, mount);
-            if (strncmp(dev, "/dev/", 5) != 0 || strstr(dev, "loop") || strstr(mount, "/snap")) continue;
-            struct statvfs svfs;
-            if (statvfs(mount, &svfs) != 0) continue;
-            double tot = (double)svfs.f_blocks * svfs.f_frsize;
-            double used = tot - (double)svfs.f_bfree * svfs.f_frsize;
-            char ub[16], tb[16];
-            fmt_bytes(ub, 16, used); fmt_bytes(tb, 16, tot);
-            printf("  %-20s %s / %s (%.0f%%)\n", mount, ub, tb, (tot > 0) ? used / tot * 100 : 0);
+    mount_usage_t mounts[MAX_MOUNTS];
+    int nm;
+    PROF("disk", nm = read_disk_usage(mounts, MAX_MOUNTS, 2500));
+    for (int i = 0; i < nm; i++) {
+        if (mounts[i].unresponsive) { printf("  %-20s unresponsive\n", mounts[i].path); continue; }
+        char ub[16], tb[16];
+        fmt_bytes(ub, 16, mounts[i].used); fmt_bytes(tb, 16, mounts[i].total);
+        printf("  %-20s %s / %s (%.0f%%)\n", mounts[i].path, ub, tb,
+               (mounts[i].total > 0) ? mounts[i].used / mounts[i].total * 100 : 0);
+    }
+
+    PROF("disk", read_disk_io(&disk_io));
+    if (disk_io.ndev > 0) {
+        printf("\n-- DISK I/O --\n");
+        printf("  %-12s %10s %10s %8s %8s %6s %8s %6s\n", "DEVICE", "READ", "WRITE", "R/S", "W/S", "UTIL", "AWAIT", "QUEUE");
+        for (int i = 0; i < disk_io.ndev; i++) {
+            const disk_dev_t *d = &disk_io.dev[i];
+            char rb[16], wb[16];
+            fmt_speed(rb, 16, d->read_bps); fmt_speed(wb, 16, d->write_bps);
+            printf("  %-12s %10s %10s %8.1f %8.1f %5.1f%% %6.2fms %6.2f\n", d->name, rb, wb,
+                   d->read_iops, d->write_iops, d->util, d->await_ms, d->queue);
         }
-        fclose(mf);
     }
 
-    docker_info_t dk[MAX_DOCKER];
-    int dc = read_docker(dk, MAX_DOCKER);
+    int dc;
+    PROF("docker", dc = read_docker(dk, MAX_DOCKER));
     if (dc > 0) {
         printf("\n-- DOCKER (%d containers) --\n", dc);
         for (int i = 0; i < dc; i++)
-            printf("  %-24s %s  CPU: %.1f%%  Mem: %.0f MB\n", dk[i].name, dk[i].status, dk[i].cpu_pct, dk[i].mem_mb);
+            printf("  %-24s %s  CPU: %.1f%%  Mem: %.0f MB  PIDs: %d\n", dk[i].name, dk[i].status, dk[i].cpu_pct, dk[i].mem_mb, dk[i].pids);
+    }
+
+    int irq_ok;
+    PROF("irq", irq_ok = read_irqs(&irq) == 0);
+    if (irq_ok && (irq.nhard || irq.nsoft)) {
+        printf("\n-- INTERRUPTS -- %.0f/s hard, %.0f/s soft\n", irq.hard_rate, irq.soft_rate);
+        print_irq_srcs("softirq", irq.soft, irq.nsoft);
+        print_irq_srcs("irq", irq.hard, irq.nhard);
+    }
+
+    int psi_ok;
+    PROF("psi", psi_ok = read_psi(psi) == 0);
+    if (psi_ok) {
+        printf("\n-- PRESSURE --\n");
+        print_psi(psi);
+        static const int trig_res[] = { PSI_MEM, PSI_IO };
+        int armed = 0;
+        for (int i = 0; i < 2; i++) {
+            int stall, window, fd = sampler_psi_open(trig_res[i], &stall, &window);
+            if (fd < 0) continue;
+            close(fd);
+            if (!armed++) printf("  trigger %dms/%gs", stall, window / 1000.0);
+            printf(" %s", psi_names[trig_res[i]]);
+        }
+        printf(armed ? "\n" : "  triggers off, polling\n");
+    }
+
+    prof_tick();
+    prof_self(&self, 0);
+    printf("\n-- CUTEDASH --\n");
+    printf("  %-16s %6s %9s %9s\n", "STAGE", "CALLS", "P50", "P99");
+    for (int i = 0; i < prof_count(); i++) {
+        const char *name;
+        unsigned n;
+        double p50, p99;
+        char b50[16], b99[16];
+        if (prof_quantiles(i, &name, &n, &p50, &p99) != 0 || !n) continue;
+        fmt_ns(b50, 16, p50); fmt_ns(b99, 16, p99);
+        printf("  %-16s %6u %9s %9s\n", name, n, b50, b99);
     }
+    printf("  CPU: %.1f%%  RSS: %.1f MB  Read/write syscalls: %.0f\n", self.cpu_pct, self.rss_kb / 1024.0, self.syscalls_per_tick);
 
     printf("\n");
 }
 
+/* Paths built from one root are opened relative to another (cgroup files
+ * under the procfs root), so roots are made absolute up front. */
+static const char *abs_root(const char *path) {
+    char *abs = realpath(path, NULL);
+    return abs ? abs : path;
+}
+
 static void usage(void) {
     printf("cutedash - terminal system dashboard\n\n"
            "Usage: stats [OPTIONS]\n\n"
@@ -125,11 +223,215 @@ static void usage(void) {
            "  --theme THEME    Color theme: default, neon, light\n"
            "  --alert-cpu N    CPU alert threshold (default: 90)\n"
            "  --alert-temp N   Temp alert threshold (default: 85)\n"
+           "  --alert-psi N    Pressure alert threshold, %% of time stalled over 10s\n"
+           "                   (default: 25); a fired PSI trigger also raises the alert\n"
+           "  --psi-trigger STALL_MS/WINDOW_MS\n"
+           "                   Wake the sampler when memory or io stall time exceeds\n"
+           "                   STALL_MS within WINDOW_MS, or \"none\" (default: 100/1000).\n"
+           "                   Without root the window rounds up to a multiple of 2s\n"
+           "                   and STALL_MS scales with it. Each trigger event publishes\n"
+           "                   an extra sample between intervals\n"
+           "  --interval MS    Refresh interval, minimum 100 (default: 1000)\n"
+           "  --workers N      Max /proc scan threads (default: auto, up to 4)\n"
+           "  --disk-partitions\n"
+           "                   Show per-partition I/O as well as whole disks\n"
+           "  --proc-root DIR  Read procfs from DIR instead of /proc\n"
+           "  --sys-root DIR   Read sysfs from DIR instead of /sys\n"
+           "  --cgroup-root DIR\n"
+           "                   cgroup v2 mount for container stats (default: SYSROOT/fs/cgroup)\n"
+           "  --docker-root DIR\n"
+           "                   Docker data dir, used for container names (default: /var/lib/docker)\n"
+           "  --collector NAME=MS[:BUDGET]\n"
+           "                   Collector interval and cost budget in ms; NAME is one of\n"
+           "                   cpu mem temps fans ifaces disk procs gpu docker battery irq psi\n"
+           "  --config FILE    Read collector settings, one NAME=MS[:BUDGET] per line\n"
+           "                   (default: $XDG_CONFIG_HOME/cutedash/collectors.conf)\n"
+           "  --history FILE   Memory-mapped history file, or \"none\"\n"
+           "                   (default: $XDG_STATE_HOME/cutedash/history)\n"
+           "  --record FILE    Append every sample to a binary recording\n"
+           "  --replay FILE    Play back a recording instead of sampling\n"
+           "  --seek TIME      Start replay at \"YYYY-MM-DD HH:MM[:SS]\" or +N[smhd]\n"
+           "  --serve ADDR     Run headless and serve OpenMetrics on /metrics; ADDR is\n"
+           "                   [HOST]:PORT (default host 127.0.0.1) or unix:PATH\n"
+           "  --json           Print one sample as a JSON object and exit\n"
+           "  --stream         Write one JSON object per sample to stdout (NDJSON); PSI\n"
+           "                   trigger events add samples between intervals\n"
            "  -h, --help       Show this help\n\n"
            "Keys:\n"
            "  c/m/p  Sort processes by CPU/MEM/PID\n"
            "  t      Cycle color theme\n"
-           "  q      Quit\n");
+           "  w      Cycle history window: 2m 10m 1h 6h 24h 7d\n"
+           "  o      Toggle self-profiling overlay\n"
+           "  g      Toggle the per-core CPU heatmap (used anyway when bars don't fit)\n"
+           "  i      Toggle the interrupt/softirq hot-spot panel\n"
+           "  s      Toggle the pressure stall (PSI) panel\n"
+           "  q      Quit\n"
+           "Replay keys:\n"
+           "  space  Pause/resume\n"
+           "  +/-    Double/halve playback speed\n"
+           "  arrows Seek 10s back/forward, PgUp/PgDn 10 minutes, Home to start\n");
+}
+
+static void draw_frame(sample_t *s) {
+    int rows, cols;
+    getmaxyx(stdscr, rows, cols);
+    erase();
+
+    int alert = (s->cpu_avg >= g_alert_cpu);
+    for (int i = 0; i < s->t_count && !alert; i++)
+        if (s->t_vals[i] >= g_alert_temp) alert = 1;
+    for (int r = 0; r < PSI_NRES && !alert; r++)
+        if (s->psi[r].some[0] >= g_alert_psi || (s->psi[r].events && s->wall - s->psi[r].event_wall < PSI_ALERT_HOLD_S)) alert = 1;
+    g_alert_flash = alert;
+
+    PROF("draw header", draw_header(stdscr, cols, s, alert));
+
+    int has_gpu = (s->gpu_count > 0);
+    int has_docker = (s->docker_count > 0);
+
+    int top_h = (rows - 2) * 3 / 5;
+    int bot_h = rows - 2 - top_h;
+    PROF("sort procs", sort_procs(&s->procs, g_sort, processes_panel_rows(bot_h)));
+
+    int ncols_top = 3 + has_gpu + g_irq_panel + g_psi_panel;
+    int col_w = cols / ncols_top;
+    int last_col_w = cols - col_w * (ncols_top - 1);
+
+    int by = 2;
+
+    PROF("draw cpu", draw_cpu_panel(by, top_h, col_w, s));
+    PROF("draw memory", draw_memory_panel(by, top_h, col_w, col_w, s->mem_total, s->mem_avail, s->mem_used, s->mem_buf, s->mem_cached, s->sw_total, s->sw_free, s->bat));
+    PROF("draw temps", draw_temps_panel(by, top_h, col_w * 2, ncols_top > 3 ? col_w : last_col_w, s->t_labels, s->t_vals, s->t_highs, s->t_count, s->fans, s->fan_count));
+    if (has_gpu) PROF("draw gpu", draw_gpu_panel(by, top_h, col_w * 3, ncols_top > 4 ? col_w : last_col_w, s->gpus, s->gpu_count));
+    if (g_irq_panel) PROF("draw irq", draw_irq_panel(by, top_h, col_w * (3 + has_gpu), g_psi_panel ? col_w : last_col_w, s));
+    if (g_psi_panel) PROF("draw psi", draw_psi_panel(by, top_h, col_w * (ncols_top - 1), last_col_w, s));
+
+    int bot_y = by + top_h;
+    int ncols_bot = 3 + has_docker;
+    int bcol_w = cols / ncols_bot;
+    int blast_w = cols - bcol_w * (ncols_bot - 1);
+
+    PROF("draw procs", draw_processes_panel(bot_y, bot_h, bcol_w, &s->procs));
+    PROF("draw network", draw_network_panel(bot_y, bot_h, bcol_w, bcol_w, s));
+    PROF("draw disk", draw_disk_panel(bot_y, bot_h, bcol_w * 2, has_docker ? bcol_w : blast_w, s));
+    if (has_docker) PROF("draw docker", draw_docker_panel(bot_y, bot_h, bcol_w * 3, blast_w, s->docker, s->docker_count));
+    if (g_profile) draw_profile_overlay(rows, cols);
+
+    PROF("refresh", refresh());
+}
+
+static void init_screen(void) {
+    initscr();
+    cbreak();
+    noecho();
+    curs_set(0);
+    nodelay(stdscr, TRUE);
+    keypad(stdscr, TRUE);
+    start_color();
+    setup_theme();
+}
+
+/* Returns -1 to quit, 1 if the frame needs redrawing, 0 if ignored. */
+static int handle_key(int ch) {
+    if (ch == 'q' || ch == 'Q') return -1;
+    else if (ch == 'c' || ch == 'C') g_sort = SORT_CPU;
+    else if (ch == 'm' || ch == 'M') g_sort = SORT_MEM;
+    else if (ch == 'p' || ch == 'P') g_sort = SORT_PID;
+    else if (ch == 't' || ch == 'T') { g_theme = (g_theme + 1) % THEME_COUNT; setup_theme(); }
+    else if (ch == 'w' || ch == 'W') g_window = (g_window + 1) % HIST_NWINDOWS;
+    else if (ch == 'o' || ch == 'O') g_profile = !g_profile;
+    else if (ch == 'g' || ch == 'G') g_cpu_heatmap = !g_cpu_heatmap;
+    else if (ch == 'i' || ch == 'I') g_irq_panel = !g_irq_panel;
+    else if (ch == 's' || ch == 'S') g_psi_panel = !g_psi_panel;
+    else return 0;
+    return 1;
+}
+
+static double parse_seek(const char *arg, double start) {
+    if (arg[0] == '+') {
+        char *end;
+        double v = strtod(arg + 1, &end);
+        if (*end == 'm') v *= 60;
+        else if (*end == 'h') v *= 3600;
+        else if (*end == 'd') v *= 86400;
+        return start + v;
+    }
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    const char *fmts[] = { "%Y-%m-%d %H:%M:%S", "%Y-%m-%dT%H:%M:%S", "%Y-%m-%d %H:%M", "%Y-%m-%dT%H:%M" };
+    for (int i = 0; i < 4; i++) {
+        const char *end = strptime(arg, fmts[i], &tm);
+        if (end && !*end) { tm.tm_isdst = -1; return (double)mktime(&tm); }
+    }
+    return -1;
+}
+
+static int run_replay(const char *path, const char *seek) {
+    if (replay_open(path) != 0) { fprintf(stderr, "cutedash: cannot replay %s\n", path); return 1; }
+    double pos = replay_sample()->wall;
+    if (seek) {
+        double t = parse_seek(seek, replay_first_wall());
+        if (t < 0) { fprintf(stderr, "cutedash: bad --seek '%s'\n", seek); return 1; }
+        replay_seek(t);
+        pos = t;
+    }
+
+    init_screen();
+    char status[64];
+    g_status = status;
+    double speed = 1, last = mono_now();
+    int paused = 0, running = 1, redraw = 1;
+    struct pollfd pfd = { .fd = STDIN_FILENO, .events = POLLIN };
+    while (running) {
+        if (g_resize) { g_resize = 0; endwin(); refresh(); clear(); redraw = 1; }
+        if (redraw) {
+            snprintf(status, sizeof(status), "REPLAY %gx%s", speed, paused ? " paused" : "");
+            draw_frame(replay_sample());
+            redraw = 0;
+        }
+        double nw = replay_next_wall();
+        if (!paused && nw - pos > 10) pos = nw;
+        int timeout = -1;
+        if (!paused && nw >= 0) {
+            double ms = (nw - pos) / speed * 1000.0;
+            timeout = ms < 0 ? 0 : ms > 1000 ? 1000 : (int)ms;
+        }
+        if (poll(&pfd, 1, timeout) < 0 && errno != EINTR) break;
+        double now = mono_now();
+        if (!paused) pos += (now - last) * speed;
+        last = now;
+
+        double target = -1;
+        int ch;
+        while ((ch = getch()) != ERR) {
+            if (ch == ' ') paused = !paused;
+            else if ((ch == '+' || ch == '=') && speed < 64) speed *= 2;
+            else if (ch == '-' && speed > 0.125) speed /= 2;
+            else if (ch == KEY_RIGHT) target = pos + 10;
+            else if (ch == KEY_LEFT) target = pos - 10;
+            else if (ch == KEY_NPAGE) target = pos + 600;
+            else if (ch == KEY_PPAGE) target = pos - 600;
+            else if (ch == KEY_HOME) target = replay_first_wall();
+            else {
+                int k = handle_key(ch);
+                if (k < 0) running = 0;
+                if (k <= 0) continue;
+            }
+            redraw = 1;
+        }
+        if (target >= 0) {
+            if (target < replay_first_wall()) target = replay_first_wall();
+            replay_seek(target);
+            pos = target;
+        }
+        while (!paused && (nw = replay_next_wall()) >= 0 && nw <= pos) {
+            if (!replay_step()) break;
+            redraw = 1;
+        }
+        if (!paused && replay_next_wall() < 0) { paused = 1; redraw = 1; }
+    }
+    endwin();
+    return 0;
 }
 
 int main(int argc, char **argv) {
@@ -140,10 +442,43 @@ int main(int argc, char **argv) {
         {"theme", required_argument, NULL, 't'},
         {"alert-cpu", required_argument, NULL, 'C'},
         {"alert-temp", required_argument, NULL, 'T'},
+        {"alert-psi", required_argument, NULL, 'A'},
+        {"psi-trigger", required_argument, NULL, 'Z'},
+        {"interval", required_argument, NULL, 'i'},
+        {"workers", required_argument, NULL, 'w'},
+        {"disk-partitions", no_argument, NULL, 'P'},
+        {"collector", required_argument, NULL, 'c'},
+        {"proc-root", required_argument, NULL, 'p'},
+        {"sys-root", required_argument, NULL, 'x'},
+        {"cgroup-root", required_argument, NULL, 'g'},
+        {"docker-root", required_argument, NULL, 'd'},
+        {"config", required_argument, NULL, 'f'},
+        {"history", required_argument, NULL, 'H'},
+        {"record", required_argument, NULL, 'R'},
+        {"replay", required_argument, NULL, 'y'},
+        {"seek", required_argument, NULL, 's'},
+        {"serve", required_argument, NULL, 'S'},
+        {"json", no_argument, NULL, 'j'},
+        {"stream", no_argument, NULL, 'n'},
         {"help", no_argument, NULL, 'h'},
         {NULL, 0, NULL, 0}
     };
-    int opt;
+    const char *config = NULL;
+    for (int i = 1; i < argc; i++)
+        if (strcmp(argv[i], "--config") == 0 && i + 1 < argc) config = argv[i + 1];
+        else if (strncmp(argv[i], "--config=", 9) == 0) config = argv[i] + 9;
+    if (config) {
+        if (sampler_load_config(config) != 0) { fprintf(stderr, "cutedash: cannot load %s\n", config); return 1; }
+    } else {
+        char path[512];
+        const char *xdg = getenv("XDG_CONFIG_HOME"), *home = getenv("HOME");
+        if (xdg && *xdg) snprintf(path, sizeof(path), "%s/cutedash/collectors.conf", xdg);
+        else snprintf(path, sizeof(path), "%s/.config/cutedash/collectors.conf", home ? home : "");
+        if (access(path, R_OK) == 0) sampler_load_config(path);
+    }
+
+    const char *history = NULL, *record = NULL, *replay = NULL, *seek = NULL, *serve = NULL;
+    int opt, json = -1;
     while ((opt = getopt_long(argc, argv, "oth", long_opts, NULL)) != -1) {
         switch (opt) {
         case 'o': g_once = 1; break;
@@ -154,149 +489,84 @@ int main(int argc, char **argv) {
             break;
         case 'C': g_alert_cpu = atoi(optarg); break;
         case 'T': g_alert_temp = atoi(optarg); break;
+        case 'A': g_alert_psi = atoi(optarg); break;
+        case 'Z':
+            if (sampler_psi_trigger(optarg) != 0) { fprintf(stderr, "cutedash: bad --psi-trigger '%s'\n", optarg); return 1; }
+            break;
+        case 'i':
+            if (sampler_set_interval(atoi(optarg)) != 0) { fprintf(stderr, "cutedash: --interval must be at least %d ms\n", MIN_INTERVAL_MS); return 1; }
+            break;
+        case 'w': g_scan_workers = atoi(optarg); break;
+        case 'P': g_disk_parts = 1; break;
+        case 'c':
+            if (sampler_configure(optarg) != 0) { fprintf(stderr, "cutedash: bad --collector '%s'\n", optarg); return 1; }
+            break;
+        case 'f': break;
+        case 'H': history = optarg; break;
+        case 'R': record = optarg; break;
+        case 'y': replay = optarg; break;
+        case 's': seek = optarg; break;
+        case 'S': serve = optarg; break;
+        case 'j': if (json < 0) json = 0; break;
+        case 'n': json = 1; break;
+        case 'p': g_proc_root = abs_root(optarg); break;
+        case 'x': g_sys_root = abs_root(optarg); break;
+        case 'g': g_cgroup_root = abs_root(optarg); break;
+        case 'd': g_docker_root = abs_root(optarg); break;
         case 'h': usage(); return 0;
         default: usage(); return 1;
         }
     }
 
+    static char cgroup_root[512];
+    if (!g_cgroup_root) {
+        snprintf(cgroup_root, sizeof(cgroup_root), "%s/fs/cgroup", g_sys_root);
+        g_cgroup_root = cgroup_root;
+    }
+
     if (g_once) { print_snapshot(); return 0; }
 
     signal(SIGWINCH, handle_resize);
+    if (replay) return run_replay(replay, seek);
+    if (record && record_open(record) != 0) { fprintf(stderr, "cutedash: cannot record to %s\n", record); return 1; }
+    if (json >= 0) { int rc = json_run(json); record_close(); return rc; }
+    if (serve) { int rc = serve_run(serve); record_close(); return rc; }
 
-    read_cpu_stats(prev_cpu, &num_cores);
-    num_cores--;
-    num_ifaces = read_ifaces(ifaces, MAX_IFACES);
-    read_disk_io(&disk_io);
-    usleep(200000);
+    char hpath[512];
+    if (!history && history_default_path(hpath, sizeof(hpath)) == 0) history = hpath;
+    if (history && strcmp(history, "none") != 0 && history_open(history) != 0)
+        fprintf(stderr, "cutedash: cannot map history file %s, keeping history in memory\n", history);
 
-    initscr();
-    cbreak();
-    noecho();
-    curs_set(0);
-    nodelay(stdscr, TRUE);
-    start_color();
-    setup_theme();
+    int wake_fd = sampler_start();
+    if (wake_fd < 0) { perror("cutedash: sampler"); return 1; }
+
+    init_screen();
 
-    while (1) {
-        int ch = getch();
-        if (ch == 'q' || ch == 'Q') break;
-        if (ch == 'c' || ch == 'C') g_sort = SORT_CPU;
-        if (ch == 'm' || ch == 'M') g_sort = SORT_MEM;
-        if (ch == 'p' || ch == 'P') g_sort = SORT_PID;
-        if (ch == 't' || ch == 'T') { g_theme = (g_theme + 1) % THEME_COUNT; setup_theme(); }
-
-        if (g_resize) { g_resize = 0; endwin(); refresh(); clear(); }
-
-        int rows, cols;
-        getmaxyx(stdscr, rows, cols);
-        erase();
-
-        cpu_stat_t cur_cpu[MAX_CORES + 1];
-        int cur_count;
-        read_cpu_stats(cur_cpu, &cur_count);
-        double core_pcts[MAX_CORES];
-        double cpu_avg = calc_cpu_pct(&cur_cpu[0], &prev_cpu[0]);
-        for (int i = 0; i < num_cores; i++)
-            core_pcts[i] = calc_cpu_pct(&cur_cpu[i + 1], &prev_cpu[i + 1]);
-        memcpy(prev_cpu, cur_cpu, sizeof(prev_cpu));
-
-        cpu_history[cpu_hist_pos] = cpu_avg;
-        cpu_hist_pos = (cpu_hist_pos + 1) % HISTORY_LEN;
-        if (cpu_hist_len < HISTORY_LEN) cpu_hist_len++;
-
-        unsigned long mem_total = 0, mem_avail = 0, mem_used = 0, mem_buf = 0, mem_cached = 0, sw_total = 0, sw_free = 0;
-        read_mem(&mem_total, &mem_avail, &mem_used, &mem_buf, &mem_cached, &sw_total, &sw_free);
-        double mem_pct = (mem_total > 0) ? (double)mem_used / mem_total * 100.0 : 0;
-
-        char t_labels[32][32]; double t_vals[32], t_highs[32], t_crits[32];
-        int t_count = read_temps(t_labels, t_vals, t_highs, t_crits, 32);
-        fan_info_t fans[16];
-        int fan_count = read_fans(fans, 16);
-
-        iface_t new_ifaces[MAX_IFACES];
-        int new_nifaces = read_ifaces(new_ifaces, MAX_IFACES);
-        double total_rx_speed = 0, total_tx_speed = 0;
-        for (int i = 0; i < new_nifaces; i++) {
-            total_rx_speed += new_ifaces[i].rx_speed;
-            total_tx_speed += new_ifaces[i].tx_speed;
+    struct pollfd pfds[2] = {
+        { .fd = STDIN_FILENO, .events = POLLIN },
+        { .fd = wake_fd, .events = POLLIN },
+    };
+    sample_t *s = NULL;
+    int running = 1;
+    while (running) {
+        if (poll(pfds, 2, -1) < 0 && errno != EINTR) break;
+
+        int redraw = 0, ch;
+        while ((ch = getch()) != ERR) {
+            int k = handle_key(ch);
+            if (k < 0) running = 0;
+            else if (k) redraw = 1;
         }
-        memcpy(ifaces, new_ifaces, sizeof(ifaces));
-        num_ifaces = new_nifaces;
-
-        net_rx_hist[net_hist_pos] = total_rx_speed;
-        net_tx_hist[net_hist_pos] = total_tx_speed;
-        net_hist_pos = (net_hist_pos + 1) % HISTORY_LEN;
-        if (net_hist_len < HISTORY_LEN) net_hist_len++;
-
-        read_disk_io(&disk_io);
-
-        proc_info_t procs[MAX_PROCS];
-        int nprocs = read_procs_with_cpu(procs, MAX_PROCS, mem_total, prev_procs, prev_nprocs);
-        memcpy(prev_procs, procs, nprocs * sizeof(proc_info_t));
-        prev_nprocs = nprocs;
-
-        if (g_sort == SORT_CPU) qsort(procs, nprocs, sizeof(proc_info_t), proc_cmp_cpu);
-        else if (g_sort == SORT_MEM) qsort(procs, nprocs, sizeof(proc_info_t), proc_cmp_mem);
-        else qsort(procs, nprocs, sizeof(proc_info_t), proc_cmp_pid);
-
-        gpu_info_t gpu = {0};
-        static int gpu_tick = 0;
-        static gpu_info_t cached_gpu = {0};
-        if (gpu_tick % 3 == 0) cached_gpu = read_gpu();
-        gpu_tick++;
-        gpu = cached_gpu;
-
-        static int docker_tick = 0;
-        static docker_info_t cached_docker[MAX_DOCKER];
-        static int cached_docker_count = 0;
-        if (docker_tick % 5 == 0) cached_docker_count = read_docker(cached_docker, MAX_DOCKER);
-        docker_tick++;
-
-        battery_t bat = {0};
-        static int bat_tick = 0;
-        static battery_t cached_bat = {0};
-        if (bat_tick % 10 == 0) cached_bat = read_battery();
-        bat_tick++;
-        bat = cached_bat;
-
-        int alert = (cpu_avg >= g_alert_cpu);
-        for (int i = 0; i < t_count && !alert; i++)
-            if (t_vals[i] >= g_alert_temp) alert = 1;
-        g_alert_flash = alert;
-
-        draw_header(stdscr, cols, cpu_avg, mem_pct, alert);
-
-        int has_gpu = gpu.has_gpu;
-        int has_docker = (cached_docker_count > 0);
-
-        int top_h = (rows - 2) * 3 / 5;
-        int bot_h = rows - 2 - top_h;
-
-        int ncols_top = 3 + has_gpu;
-        int col_w = cols / ncols_top;
-        int last_col_w = cols - col_w * (ncols_top - 1);
-
-        int by = 2;
-
-        draw_cpu_panel(by, top_h, col_w, core_pcts, cpu_avg);
-        draw_memory_panel(by, top_h, col_w, col_w, mem_total, mem_avail, mem_used, mem_buf, mem_cached, sw_total, sw_free, bat);
-        draw_temps_panel(by, top_h, col_w * 2, has_gpu ? col_w : last_col_w, t_labels, t_vals, t_highs, t_count, fans, fan_count);
-        if (has_gpu) draw_gpu_panel(by, top_h, col_w * 3, last_col_w, gpu);
-
-        int bot_y = by + top_h;
-        int ncols_bot = 3 + has_docker;
-        int bcol_w = cols / ncols_bot;
-        int blast_w = cols - bcol_w * (ncols_bot - 1);
-
-        draw_processes_panel(bot_y, bot_h, bcol_w, procs, nprocs);
-        draw_network_panel(bot_y, bot_h, bcol_w, bcol_w, total_rx_speed, total_tx_speed);
-        draw_disk_panel(bot_y, bot_h, bcol_w * 2, has_docker ? bcol_w : blast_w, has_docker);
-        if (has_docker) draw_docker_panel(bot_y, bot_h, bcol_w * 3, blast_w, cached_docker, cached_docker_count);
-
-        refresh();
-        usleep(REFRESH_MS * 1000);
+        if (!running) break;
+        if (g_resize) { g_resize = 0; endwin(); refresh(); clear(); redraw = 1; }
+
+        int fresh;
+        s = sampler_acquire(&fresh);
+        if ((redraw || fresh) && s->valid) draw_frame(s);
     }
 
     endwin();
+    record_close();
+    history_close();
     return 0;
 }
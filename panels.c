@@ -1,19 +1,100 @@
 #include "cutedash.h"
 
-void draw_cpu_panel(int by, int top_h, int pw, double *core_pcts, double cpu_avg) {
+static void put_run(const char *run, int len, int color) {
+    wattron(stdscr, COLOR_PAIR(color));
+    waddnstr(stdscr, run, len);
+    wattroff(stdscr, COLOR_PAIR(color));
+}
+
+/* Fewest cores per cell that fits every group into rows; a folded cell
+ * shows its busiest core. */
+static int heatmap_fold(const cpu_group_t *groups, int ng, int n, int cw, int rows) {
+    int f = 1;
+    for (;; f++) {
+        int need = 0;
+        for (int g = 0; g < ng; g++) need += ((groups[g].len + f - 1) / f + cw - 1) / cw;
+        if (need <= rows || f >= n) return f;
+    }
+}
+
+/* One cell per core, grouped by NUMA node and socket when the topology
+ * matches the sample. Same-colored runs go out in a single waddnstr. */
+static int draw_cpu_heatmap(int y, int x, int w, int rows, const sample_t *s, int *fold) {
+    int n = s->num_cores;
+    const uint16_t *order = cpu_topo.n == n ? cpu_topo.order : NULL;
+    int grouped = order && cpu_topo.ngroups > 1;
+    cpu_group_t flat = { 0, 0, 0, n };
+    const cpu_group_t *groups = grouped ? cpu_topo.group : &flat;
+    int ng = grouped ? cpu_topo.ngroups : 1, lw = grouped ? 7 : 0;
+    for (int g = 0; grouped && g < ng; g++) {
+        int l = snprintf(NULL, 0, "N%d S%d ", groups[g].node, groups[g].pkg);
+        if (l > lw) lw = l;
+    }
+    int cw = w - lw;
+    if (cw > 300) cw = 300;
+    if (cw < 1 || rows < 1 || n < 1) return 0;
+    int f = *fold = heatmap_fold(groups, ng, n, cw, rows);
+    char run[1024];
+    int row = 0;
+    for (int g = 0; g < ng && row < rows; g++) {
+        const cpu_group_t *gr = &groups[g];
+        int cells = (gr->len + f - 1) / f;
+        if (grouped) {
+            wattron(stdscr, COLOR_PAIR(CLR_DIM));
+            mvwprintw(stdscr, y + row, x, "N%d S%d", gr->node, gr->pkg);
+            wattroff(stdscr, COLOR_PAIR(CLR_DIM));
+        }
+        for (int c = 0; c < cells && row < rows; row++) {
+            wmove(stdscr, y + row, x + lw);
+            int len = 0, color = 0;
+            for (int k = 0; k < cw && c < cells; k++, c++) {
+                double v = 0;
+                for (int j = c * f; j < (c + 1) * f && j < gr->len; j++) {
+                    int core = order ? order[gr->start + j] : gr->start + j;
+                    if (s->core_pcts[core] > v) v = s->core_pcts[core];
+                }
+                int lvl = (int)(v / 100.0 * 7 + 0.5);
+                if (lvl > 7) lvl = 7;
+                int cc = v < 1.0 ? CLR_DIM : color_for_pct(v);
+                if (cc != color && len) { put_run(run, len, color); len = 0; }
+                color = cc;
+                size_t gl = strlen(SPARK[lvl]);
+                memcpy(run + len, SPARK[lvl], gl);
+                len += (int)gl;
+            }
+            if (len) put_run(run, len, color);
+        }
+    }
+    return row;
+}
+
+void draw_cpu_panel(int by, int top_h, int pw, const sample_t *s) {
+    const double *core_pcts = s->core_pcts;
+    double cpu_avg = s->cpu_avg;
+    int num_cores = s->num_cores;
+    int rows = top_h - 9, fold = 1;
+    int heat = g_cpu_heatmap || (num_cores + 1) / 2 > rows;
     draw_box(stdscr, by, 0, top_h, pw, CLR_CYAN, "CPU");
     int bar_w = pw / 2 - 12;
     if (bar_w < 8) bar_w = 8;
     if (bar_w > 30) bar_w = 30;
     int cy = by + 2;
-    for (int i = 0; i < num_cores && cy < by + top_h - 5; i += 2) {
+    if (heat) {
+        cy += draw_cpu_heatmap(cy, 3, pw - 6, rows, s, &fold);
+        if (fold > 1) {
+            wattron(stdscr, COLOR_PAIR(CLR_DIM));
+            mvwprintw(stdscr, by, 8, " max of %d per cell ", fold);
+            wattroff(stdscr, COLOR_PAIR(CLR_DIM));
+        }
+    }
+    for (int i = 0; !heat && i < num_cores && cy < by + top_h - 7; i += 2) {
         for (int j = 0; j < 2 && (i + j) < num_cores; j++) {
             int cx = 3 + j * (bar_w + 11);
             int core = i + j;
             wattron(stdscr, COLOR_PAIR(CLR_DIM));
             mvwprintw(stdscr, cy, cx, "C%-2d", core);
             wattroff(stdscr, COLOR_PAIR(CLR_DIM));
-            draw_bar(stdscr, cy, cx + 4, bar_w, core_pcts[core], color_for_pct(core_pcts[core]));
+            draw_stacked_bar(stdscr, cy, cx + 4, bar_w, &s->core_state[0][core], MAX_CORES, cpu_state_colors, CPU_NSTATES);
             wattron(stdscr, COLOR_PAIR(color_for_pct(core_pcts[core])) | A_BOLD);
             wprintw(stdscr, " %5.1f%%", core_pcts[core]);
             wattroff(stdscr, COLOR_PAIR(color_for_pct(core_pcts[core])) | A_BOLD);
@@ -23,17 +104,32 @@ void draw_cpu_panel(int by, int top_h, int pw, double *core_pcts, double cpu_avg
     cy++;
     int ac = color_for_pct(cpu_avg);
     wattron(stdscr, A_BOLD); mvwprintw(stdscr, cy, 3, "AVG"); wattroff(stdscr, A_BOLD);
-    draw_bar(stdscr, cy, 7, bar_w, cpu_avg, ac);
+    draw_stacked_bar(stdscr, cy, 7, bar_w, s->cpu_state, 1, cpu_state_colors, CPU_NSTATES);
     wattron(stdscr, COLOR_PAIR(ac) | A_BOLD); wprintw(stdscr, " %5.1f%%", cpu_avg); wattroff(stdscr, COLOR_PAIR(ac) | A_BOLD);
     cy++;
     int sw = pw - 10;
     if (sw > HISTORY_LEN) sw = HISTORY_LEN;
     if (sw < 10) sw = 10;
-    draw_sparkline(stdscr, cy, 7, cpu_history, cpu_hist_len, cpu_hist_pos, HISTORY_LEN, sw);
+    draw_history(stdscr, cy, 7, HIST_CPU, sw);
+    cy++;
+    static const char *abbr[CPU_NSTATES] = { "us", "sy", "wa", "hi", "si", "st" };
+    wmove(stdscr, cy, 3);
+    for (int k = 0, used = 0; k < CPU_NSTATES; k++) {
+        char item[16];
+        int len = snprintf(item, sizeof(item), "%s %.1f ", abbr[k], s->cpu_state[k]);
+        if ((used += len) > pw - 6) break;
+        wattron(stdscr, COLOR_PAIR(cpu_state_colors[k])); wprintw(stdscr, "%s", item); wattroff(stdscr, COLOR_PAIR(cpu_state_colors[k]));
+    }
+    cy++;
+    int hw = (pw - 14) / 2;
+    if (hw > HISTORY_LEN) hw = HISTORY_LEN;
+    if (hw >= 4) {
+        wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, cy, 3, "st"); mvwprintw(stdscr, cy, 8 + hw, "wa"); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
+        draw_history(stdscr, cy, 6, HIST_CPU_STEAL, hw);
+        draw_history(stdscr, cy, 11 + hw, HIST_CPU_IOWAIT, hw);
+    }
     cy++;
-    double l1 = 0, l5 = 0, l15 = 0;
-    FILE *lf = fopen("/proc/loadavg", "r");
-    if (lf) { (void)fscanf(lf, "%lf %lf %lf", &l1, &l5, &l15); fclose(lf); }
+    double l1 = s->load1, l5 = s->load5, l15 = s->load15;
     wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, cy, 3, "Load:"); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
     wattron(stdscr, COLOR_PAIR(color_for_pct(l1 / num_cores * 100)));
     wprintw(stdscr, " %.2f", l1);
@@ -119,61 +215,82 @@ void draw_temps_panel(int by, int top_h, int px, int pw,
     }
 }
 
-void draw_gpu_panel(int by, int top_h, int px, int pw, gpu_info_t gpu) {
-    draw_box(stdscr, by, px, top_h, pw, CLR_GREEN, "GPU");
+void draw_gpu_panel(int by, int top_h, int px, int pw, const gpu_info_t *gpus, int count) {
+    draw_box(stdscr, by, px, top_h, pw, CLR_GREEN, count > 1 ? "GPUS" : "GPU");
     int gy = by + 2;
     int gbw = pw - 16;
     if (gbw < 8) gbw = 8; if (gbw > 25) gbw = 25;
+    int gap = count > 1 ? 1 : 2;
 
-    wattron(stdscr, A_BOLD); mvwprintw(stdscr, gy, px + 3, "%.20s", gpu.name); wattroff(stdscr, A_BOLD);
-    gy += 2;
-    wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, gy, px + 3, "GPU  "); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
-    draw_bar(stdscr, gy, px + 8, gbw, gpu.gpu_util, color_for_pct(gpu.gpu_util));
-    wattron(stdscr, COLOR_PAIR(color_for_pct(gpu.gpu_util)) | A_BOLD); wprintw(stdscr, " %3d%%", gpu.gpu_util); wattroff(stdscr, A_BOLD);
-    gy++;
-    double gpu_mem_pct = gpu.mem_total_mb > 0 ? (double)gpu.mem_used_mb / gpu.mem_total_mb * 100.0 : 0;
-    wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, gy, px + 3, "VRAM "); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
-    draw_bar(stdscr, gy, px + 8, gbw, gpu_mem_pct, color_for_pct(gpu_mem_pct));
-    wattron(stdscr, COLOR_PAIR(color_for_pct(gpu_mem_pct)) | A_BOLD); wprintw(stdscr, " %3d%%", gpu.mem_util); wattroff(stdscr, A_BOLD);
-    gy += 2;
-    wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, gy, px + 3, "Mem: "); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
-    wattron(stdscr, A_BOLD); wprintw(stdscr, "%d", gpu.mem_used_mb); wattroff(stdscr, A_BOLD);
-    wattron(stdscr, COLOR_PAIR(CLR_DIM)); wprintw(stdscr, " / %d MB", gpu.mem_total_mb); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
-    gy++;
-    int tc = color_for_pct(gpu.temp > 40 ? gpu.temp : 0);
-    wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, gy, px + 3, "Temp: "); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
-    wattron(stdscr, COLOR_PAIR(tc) | A_BOLD); wprintw(stdscr, "%d\u00b0C", gpu.temp); wattroff(stdscr, COLOR_PAIR(tc) | A_BOLD);
-    if (gpu.fan_pct >= 0) {
-        wattron(stdscr, COLOR_PAIR(CLR_DIM)); wprintw(stdscr, "  Fan: "); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
-        wprintw(stdscr, "%d%%", gpu.fan_pct);
-    }
-    if (gpu.power_w > 0) {
+    for (int i = 0; i < count && gy < by + top_h - 4; i++) {
+        const gpu_info_t *g = &gpus[i];
+        wattron(stdscr, A_BOLD);
+        if (count > 1) mvwprintw(stdscr, gy, px + 3, "%d %.20s", g->index, g->name);
+        else mvwprintw(stdscr, gy, px + 3, "%.20s", g->name);
+        wattroff(stdscr, A_BOLD);
+        if (g->stale) { wattron(stdscr, COLOR_PAIR(CLR_DIM)); wprintw(stdscr, " stale"); wattroff(stdscr, COLOR_PAIR(CLR_DIM)); }
+        gy += gap;
+        wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, gy, px + 3, "GPU  "); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
+        draw_bar(stdscr, gy, px + 8, gbw, g->gpu_util, color_for_pct(g->gpu_util));
+        wattron(stdscr, COLOR_PAIR(color_for_pct(g->gpu_util)) | A_BOLD); wprintw(stdscr, " %3d%%", g->gpu_util); wattroff(stdscr, A_BOLD);
         gy++;
-        wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, gy, px + 3, "Power: "); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
-        wprintw(stdscr, "%dW / %dW", gpu.power_w, gpu.power_max_w);
+        double gpu_mem_pct = g->mem_total_mb > 0 ? (double)g->mem_used_mb / g->mem_total_mb * 100.0 : 0;
+        wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, gy, px + 3, "VRAM "); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
+        draw_bar(stdscr, gy, px + 8, gbw, gpu_mem_pct, color_for_pct(gpu_mem_pct));
+        wattron(stdscr, COLOR_PAIR(color_for_pct(gpu_mem_pct)) | A_BOLD); wprintw(stdscr, " %3d%%", g->mem_util); wattroff(stdscr, A_BOLD);
+        gy += gap;
+        if (count == 1) {
+            wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, gy, px + 3, "Mem: "); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
+            wattron(stdscr, A_BOLD); wprintw(stdscr, "%d", g->mem_used_mb); wattroff(stdscr, A_BOLD);
+            wattron(stdscr, COLOR_PAIR(CLR_DIM)); wprintw(stdscr, " / %d MB", g->mem_total_mb); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
+            gy++;
+        }
+        int tc = color_for_pct(g->temp > 40 ? g->temp : 0);
+        wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, gy, px + 3, "Temp: "); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
+        wattron(stdscr, COLOR_PAIR(tc) | A_BOLD); wprintw(stdscr, "%d\u00b0C", g->temp); wattroff(stdscr, COLOR_PAIR(tc) | A_BOLD);
+        if (g->fan_pct >= 0) {
+            wattron(stdscr, COLOR_PAIR(CLR_DIM)); wprintw(stdscr, "  Fan: "); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
+            wprintw(stdscr, "%d%%", g->fan_pct);
+        }
+        if (g->power_w > 0) {
+            if (count == 1) {
+                gy++;
+                wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, gy, px + 3, "Power: "); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
+            } else {
+                wattron(stdscr, COLOR_PAIR(CLR_DIM)); wprintw(stdscr, "  "); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
+            }
+            wprintw(stdscr, "%dW / %dW", g->power_w, g->power_max_w);
+        }
+        gy += 2;
     }
 }
 
-void draw_processes_panel(int bot_y, int bot_h, int pw,
-                          proc_info_t *procs, int nprocs) {
+int processes_panel_rows(int bot_h) {
+    int max_show = bot_h - 4;
+    if (max_show > 20) max_show = 20;
+    return max_show < 0 ? 0 : max_show;
+}
+
+void draw_processes_panel(int bot_y, int bot_h, int pw, const proc_table_t *pt) {
     draw_box(stdscr, bot_y, 0, bot_h, pw, CLR_GREEN, "PROCESSES [c/m/p]");
     int py = bot_y + 1;
     wattron(stdscr, COLOR_PAIR(CLR_DIM) | A_BOLD);
     mvwprintw(stdscr, py, 3, "%-7s %-16s %7s %7s", "PID", "PROCESS", "CPU%", "MEM%");
     wattroff(stdscr, COLOR_PAIR(CLR_DIM) | A_BOLD);
     py++;
-    int max_show = bot_h - 4;
-    if (max_show > 20) max_show = 20;
-    for (int i = 0; i < max_show && i < nprocs && py < bot_y + bot_h - 1; i++) {
-        if (procs[i].cpu_pct < 0.05 && procs[i].mem_pct < 0.05) continue;
-        wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, py, 3, "%-7d", procs[i].pid); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
-        mvwprintw(stdscr, py, 11, "%-16.16s", procs[i].name);
-        int cc = color_for_pct(procs[i].cpu_pct);
-        wattron(stdscr, COLOR_PAIR(cc)); wprintw(stdscr, " %6.1f%%", procs[i].cpu_pct); wattroff(stdscr, COLOR_PAIR(cc));
-        int mc = color_for_pct(procs[i].mem_pct * 2);
-        wattron(stdscr, COLOR_PAIR(mc)); wprintw(stdscr, " %6.1f%%", procs[i].mem_pct); wattroff(stdscr, COLOR_PAIR(mc));
+    int max_show = processes_panel_rows(bot_h);
+    for (int i = 0; i < max_show && i < pt->ntop && py < bot_y + bot_h - 1; i++) {
+        uint32_t r = pt->order[i];
+        double cpu = pt->cpu_pct[r], mem = pt->mem_pct[r];
+        if (cpu < 0.05 && mem < 0.05) continue;
+        wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, py, 3, "%-7d", pt->pid[r]); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
+        mvwprintw(stdscr, py, 11, "%-16.16s", PROC_NAME(pt, r));
+        int cc = color_for_pct(cpu);
+        wattron(stdscr, COLOR_PAIR(cc)); wprintw(stdscr, " %6.1f%%", cpu); wattroff(stdscr, COLOR_PAIR(cc));
+        int mc = color_for_pct(mem * 2);
+        wattron(stdscr, COLOR_PAIR(mc)); wprintw(stdscr, " %6.1f%%", mem); wattroff(stdscr, COLOR_PAIR(mc));
 
-        int mini = (int)(procs[i].cpu_pct / 10);
+        int mini = (int)(cpu / 10);
         if (mini > 8) mini = 8;
         wprintw(stdscr, " ");
         wattron(stdscr, COLOR_PAIR(cc));
@@ -182,18 +299,19 @@ void draw_processes_panel(int bot_y, int bot_h, int pw,
         py++;
     }
     wattron(stdscr, COLOR_PAIR(CLR_DIM));
-    mvwprintw(stdscr, bot_y + bot_h - 2, 3, "%d processes", nprocs);
+    mvwprintw(stdscr, bot_y + bot_h - 2, 3, "%d processes", pt->count);
     wattroff(stdscr, COLOR_PAIR(CLR_DIM));
 }
 
-void draw_network_panel(int bot_y, int bot_h, int px, int pw,
-                        double total_rx_speed, double total_tx_speed) {
+void draw_network_panel(int bot_y, int bot_h, int px, int pw, const sample_t *s) {
+    const iface_t *ifaces = s->ifaces;
+    int num_ifaces = s->num_ifaces;
     draw_box(stdscr, bot_y, px, bot_h, pw, CLR_BLUE, "NETWORK");
     int ny = bot_y + 2;
     char sb[32], tb[32];
 
     wattron(stdscr, COLOR_PAIR(CLR_GREEN)); mvwprintw(stdscr, ny, px + 3, "\u25b2 UP  "); wattroff(stdscr, COLOR_PAIR(CLR_GREEN));
-    fmt_speed(sb, sizeof(sb), total_tx_speed);
+    fmt_speed(sb, sizeof(sb), s->total_tx_speed);
     unsigned long long total_tx = 0;
     for (int i = 0; i < num_ifaces; i++) total_tx += ifaces[i].tx;
     fmt_bytes(tb, sizeof(tb), (double)total_tx);
@@ -202,7 +320,7 @@ void draw_network_panel(int bot_y, int bot_h, int px, int pw,
     ny++;
 
     wattron(stdscr, COLOR_PAIR(CLR_BLUE)); mvwprintw(stdscr, ny, px + 3, "\u25bc DN  "); wattroff(stdscr, COLOR_PAIR(CLR_BLUE));
-    fmt_speed(sb, sizeof(sb), total_rx_speed);
+    fmt_speed(sb, sizeof(sb), s->total_rx_speed);
     unsigned long long total_rx = 0;
     for (int i = 0; i < num_ifaces; i++) total_rx += ifaces[i].rx;
     fmt_bytes(tb, sizeof(tb), (double)total_rx);
@@ -214,10 +332,10 @@ void draw_network_panel(int bot_y, int bot_h, int px, int pw,
     if (nsw > HISTORY_LEN) nsw = HISTORY_LEN;
     if (nsw < 8) nsw = 8;
     wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, ny, px + 3, "Up   "); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
-    draw_sparkline(stdscr, ny, px + 8, net_tx_hist, net_hist_len, net_hist_pos, HISTORY_LEN, nsw);
+    draw_history(stdscr, ny, px + 8, HIST_NET_TX, nsw);
     ny++;
     wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, ny, px + 3, "Down "); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
-    draw_sparkline(stdscr, ny, px + 8, net_rx_hist, net_hist_len, net_hist_pos, HISTORY_LEN, nsw);
+    draw_history(stdscr, ny, px + 8, HIST_NET_RX, nsw);
     ny += 2;
 
     if (num_ifaces > 1 && ny < bot_y + bot_h - 2) {
@@ -236,43 +354,58 @@ void draw_network_panel(int bot_y, int bot_h, int px, int pw,
     }
 }
 
-void draw_disk_panel(int bot_y, int bot_h, int px, int pw, int has_docker) {
-    (void)has_docker;
+void draw_disk_panel(int bot_y, int bot_h, int px, int pw, const sample_t *s) {
+    const disk_io_t *dio = &s->disk_io;
     draw_box(stdscr, bot_y, px, bot_h, pw, CLR_YELLOW, "DISK");
     int dy = bot_y + 2;
     int dbw = pw - 26;
     if (dbw < 6) dbw = 6; if (dbw > 25) dbw = 25;
 
-    FILE *mf = fopen("/proc/mounts", "r");
-    if (mf) {
-        char mline[512];
-        while (fgets(mline, sizeof(mline), mf) && dy < bot_y + bot_h - 5) {
-            char dev[128], mount[128];
-            sscanf(mline, "%127s %127s", dev, mount);
-            if (strncmp(dev, "/dev/", 5) != 0 || strstr(dev, "loop") || strstr(mount, "/snap")) continue;
-            struct statvfs st;
-            if (statvfs(mount, &st) != 0) continue;
-            double tot = (double)st.f_blocks * st.f_frsize;
-            double used = tot - (double)st.f_bfree * st.f_frsize;
-            double pct = (tot > 0) ? used / tot * 100.0 : 0;
-            const char *label = mount;
-            if (strcmp(mount, "/") == 0) label = "/";
-            else if (strstr(mount, "home")) label = "~";
-            else if (strstr(mount, "boot")) label = "boot";
+    int dev_rows = dio->ndev ? dio->ndev + 1 : 0;
+    for (int i = 0; i < s->mount_count && dy < bot_y + bot_h - 5 - dev_rows; i++) {
+        const char *mount = s->mounts[i].path;
+        double tot = s->mounts[i].total;
+        double used = s->mounts[i].used;
+        double pct = (tot > 0) ? used / tot * 100.0 : 0;
+        const char *label = mount;
+        if (strcmp(mount, "/") == 0) label = "/";
+        else if (strstr(mount, "home")) label = "~";
+        else if (strstr(mount, "boot")) label = "boot";
 
-            wattron(stdscr, A_BOLD); mvwprintw(stdscr, dy, px + 3, "%-6.6s", label); wattroff(stdscr, A_BOLD);
-            draw_bar(stdscr, dy, px + 10, dbw, pct, color_for_pct(pct));
-            char ub[16], tbb[16];
-            fmt_bytes(ub, 16, used); fmt_bytes(tbb, 16, tot);
-            wattron(stdscr, COLOR_PAIR(CLR_DIM)); wprintw(stdscr, " %s/%s", ub, tbb); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
+        wattron(stdscr, A_BOLD); mvwprintw(stdscr, dy, px + 3, "%-6.6s", label); wattroff(stdscr, A_BOLD);
+        if (s->mounts[i].unresponsive) {
+            wattron(stdscr, COLOR_PAIR(CLR_RED)); mvwprintw(stdscr, dy, px + 10, "unresponsive"); wattroff(stdscr, COLOR_PAIR(CLR_RED));
             dy++;
+            continue;
         }
-        fclose(mf);
+        draw_bar(stdscr, dy, px + 10, dbw, pct, color_for_pct(pct));
+        char ub[16], tbb[16];
+        fmt_bytes(ub, 16, used); fmt_bytes(tbb, 16, tot);
+        wattron(stdscr, COLOR_PAIR(CLR_DIM)); wprintw(stdscr, " %s/%s", ub, tbb); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
+        dy++;
+    }
+    if (dio->ndev && dy < bot_y + bot_h - 6) {
+        wattron(stdscr, COLOR_PAIR(CLR_DIM) | A_BOLD);
+        mvwprintw(stdscr, dy++, px + 3, "%-7s %10s %10s %6s %5s %7s", "DEVICE", "READ", "WRITE", "IOPS", "UTIL", "AWAIT");
+        wattroff(stdscr, COLOR_PAIR(CLR_DIM) | A_BOLD);
+    }
+    for (int i = 0; i < dio->ndev && dy < bot_y + bot_h - 5; i++) {
+        const disk_dev_t *d = &dio->dev[i];
+        char rb[16], wb[16];
+        fmt_speed(rb, 16, d->read_bps); fmt_speed(wb, 16, d->write_bps);
+        mvwprintw(stdscr, dy, px + 3, "%-7.7s %10s %10s %6.0f", d->name, rb, wb, d->read_iops + d->write_iops);
+        int uc = color_for_pct(d->util);
+        wattron(stdscr, COLOR_PAIR(uc)); wprintw(stdscr, " %4.0f%%", d->util); wattroff(stdscr, COLOR_PAIR(uc));
+        wprintw(stdscr, " %5.1fms", d->await_ms);
+        int sw = pw - 56;
+        if (sw > HISTORY_LEN) sw = HISTORY_LEN;
+        if (sw >= 4) draw_history(stdscr, dy, px + 54, history_keyed(HKEY_DISK_UTIL, d->name, 0), sw);
+        dy++;
     }
     dy++;
     char rs[16], ws[16];
-    fmt_speed(rs, 16, disk_io.read_speed);
-    fmt_speed(ws, 16, disk_io.write_speed);
+    fmt_speed(rs, 16, dio->read_speed);
+    fmt_speed(ws, 16, dio->write_speed);
     wattron(stdscr, COLOR_PAIR(CLR_GREEN)); mvwprintw(stdscr, dy, px + 3, "\u25b2 Write "); wattroff(stdscr, COLOR_PAIR(CLR_GREEN));
     wprintw(stdscr, "%s", ws);
     dy++;
@@ -283,10 +416,10 @@ void draw_disk_panel(int bot_y, int bot_h, int px, int pw, int has_docker) {
     if (dsw > HISTORY_LEN) dsw = HISTORY_LEN;
     if (dsw < 8) dsw = 8;
     wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, dy, px + 3, "W "); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
-    draw_sparkline(stdscr, dy, px + 5, disk_io.write_hist, disk_io.hist_len, disk_io.hist_pos, HISTORY_LEN, dsw);
+    draw_history(stdscr, dy, px + 5, HIST_DISK_WRITE, dsw);
     dy++;
     wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, dy, px + 3, "R "); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
-    draw_sparkline(stdscr, dy, px + 5, disk_io.read_hist, disk_io.hist_len, disk_io.hist_pos, HISTORY_LEN, dsw);
+    draw_history(stdscr, dy, px + 5, HIST_DISK_READ, dsw);
 }
 
 void draw_docker_panel(int bot_y, int bot_h, int px, int pw,
@@ -294,7 +427,7 @@ void draw_docker_panel(int bot_y, int bot_h, int px, int pw,
     draw_box(stdscr, bot_y, px, bot_h, pw, CLR_CYAN, "DOCKER");
     int dky = bot_y + 2;
     wattron(stdscr, COLOR_PAIR(CLR_DIM) | A_BOLD);
-    mvwprintw(stdscr, dky, px + 3, "%-18s %7s %8s %s", "CONTAINER", "CPU%", "MEM", "STATUS");
+    mvwprintw(stdscr, dky, px + 3, "%-18s %7s %8s %5s %s", "CONTAINER", "CPU%", "MEM", "PIDS", "STATUS");
     wattroff(stdscr, COLOR_PAIR(CLR_DIM) | A_BOLD);
     dky++;
     for (int i = 0; i < count && dky < bot_y + bot_h - 1; i++) {
@@ -302,7 +435,189 @@ void draw_docker_panel(int bot_y, int bot_h, int px, int pw,
         int cc = color_for_pct(containers[i].cpu_pct);
         wattron(stdscr, COLOR_PAIR(cc)); wprintw(stdscr, " %6.1f%%", containers[i].cpu_pct); wattroff(stdscr, COLOR_PAIR(cc));
         wprintw(stdscr, " %6.0fMB", containers[i].mem_mb);
+        wprintw(stdscr, " %5d", containers[i].pids);
         wattron(stdscr, COLOR_PAIR(CLR_DIM)); wprintw(stdscr, " %s", containers[i].status); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
         dky++;
     }
 }
+
+void draw_profile_overlay(int rows, int cols) {
+    int n = prof_count(), w = 46, h = n + 5;
+    if (h > rows - 2) h = rows - 2;
+    if (w > cols) w = cols;
+    int y = 2, x = cols - w;
+    if (h < 6) return;
+    for (int r = 0; r < h; r++) mvwhline(stdscr, y + r, x, ' ', w);
+    draw_box(stdscr, y, x, h, w, CLR_MAGENTA, "CUTEDASH COST");
+    int py = y + 1;
+    wattron(stdscr, COLOR_PAIR(CLR_DIM) | A_BOLD);
+    mvwprintw(stdscr, py++, x + 2, "%-16s %7s %8s %8s", "STAGE", "CALLS", "P50", "P99");
+    wattroff(stdscr, COLOR_PAIR(CLR_DIM) | A_BOLD);
+    for (int i = 0; i < n && py < y + h - 3; i++) {
+        const char *name;
+        unsigned calls;
+        double p50, p99;
+        char b50[16], b99[16];
+        if (prof_quantiles(i, &name, &calls, &p50, &p99) != 0 || !calls) continue;
+        fmt_ns(b50, 16, p50); fmt_ns(b99, 16, p99);
+        mvwprintw(stdscr, py, x + 2, "%-16.16s %7u %8s ", name, calls, b50);
+        int cc = p99 >= 50e6 ? CLR_RED : p99 >= 10e6 ? CLR_YELLOW : CLR_GREEN;
+        wattron(stdscr, COLOR_PAIR(cc)); wprintw(stdscr, "%8s", b99); wattroff(stdscr, COLOR_PAIR(cc));
+        py++;
+    }
+    prof_self_t self;
+    prof_self(&self, 1.0);
+    py = y + h - 3;
+    mvwhline(stdscr, py++, x + 1, ACS_HLINE, w - 2);
+    char rss[16], sc[16] = "-";
+    fmt_bytes(rss, 16, self.rss_kb * 1024.0);
+    if (self.syscalls_per_tick >= 0) snprintf(sc, sizeof(sc), "%.0f", self.syscalls_per_tick);
+    mvwprintw(stdscr, py, x + 2, "CPU %5.1f%%  RSS %s  syscalls/tick %s", self.cpu_pct < 0 ? 0 : self.cpu_pct, rss, sc);
+}
+
+static void fmt_rate(char *buf, size_t sz, double v) {
+    if (v < 1e3) snprintf(buf, sz, "%.0f", v);
+    else if (v < 1e6) snprintf(buf, sz, "%.1fk", v / 1e3);
+    else snprintf(buf, sz, "%.1fM", v / 1e6);
+}
+
+/* One source per row: name, events/s and the CPUs that took most of them
+ * as cpu:share. Softirq shares are colored, since one core taking all of
+ * NET_RX is the hot spot; a hard IRQ vector on one core is normal. */
+static int draw_irq_srcs(int y, int ymax, int x, int w, const char *title, double total,
+                         const irq_src_t *src, int n, int soft) {
+    int nw = w / 3, cw;
+    if (nw < 6) nw = 6;
+    if (nw > 28) nw = 28;
+    cw = w - nw - 7;
+    char rb[16], cb[64];
+    fmt_rate(rb, sizeof(rb), total);
+    wattron(stdscr, COLOR_PAIR(CLR_DIM) | A_BOLD);
+    mvwprintw(stdscr, y++, x, "%-*.*s %6s", nw, nw, title, rb);
+    if (cw >= 5) wprintw(stdscr, " CPUS");
+    wattroff(stdscr, COLOR_PAIR(CLR_DIM) | A_BOLD);
+    for (int i = 0; i < n && y < ymax; i++, y++) {
+        fmt_rate(rb, sizeof(rb), src[i].rate);
+        mvwprintw(stdscr, y, x, "%-*.*s %6s", nw, nw, src[i].name, rb);
+        int used = 0, k = 0;
+        for (; k < IRQ_TOP_CPUS && src[i].cpu[k] >= 0; k++) {
+            double share = src[i].cpu_rate[k] / src[i].rate * 100.0;
+            int len = snprintf(cb, sizeof(cb), " %d:%.0f%%", src[i].cpu[k], share);
+            if (used + len > cw) break;
+            int cc = soft && k == 0 ? color_for_pct(share) : CLR_DIM;
+            wattron(stdscr, COLOR_PAIR(cc)); wprintw(stdscr, "%s", cb); wattroff(stdscr, COLOR_PAIR(cc));
+            used += len;
+        }
+        if (src[i].ncpus > k && used + 4 <= cw) {
+            wattron(stdscr, COLOR_PAIR(CLR_DIM)); wprintw(stdscr, " +%d", src[i].ncpus - k); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
+        }
+    }
+    return y;
+}
+
+void draw_irq_panel(int by, int top_h, int px, int pw, const sample_t *s) {
+    const irq_top_t *irq = &s->irq;
+    draw_box(stdscr, by, px, top_h, pw, CLR_YELLOW, "INTERRUPTS");
+    int y = by + 2, ymax = by + top_h - 1, w = pw - 5;
+    if (!irq->nhard && !irq->nsoft) {
+        wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, y, px + 3, "no data"); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
+        return;
+    }
+    int hot = -1;
+    double hot_pct = 0;
+    for (int i = 0; i < s->num_cores; i++) {
+        double v = s->core_state[CPU_SOFTIRQ][i] + s->core_state[CPU_IRQ][i];
+        if (v > hot_pct) { hot_pct = v; hot = i; }
+    }
+    if (hot >= 0) {
+        wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, y, px + 3, "hottest"); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
+        int cc = color_for_pct(hot_pct);
+        wattron(stdscr, COLOR_PAIR(cc) | A_BOLD);
+        wprintw(stdscr, " C%d si %.1f%% hi %.1f%%", hot, s->core_state[CPU_SOFTIRQ][hot], s->core_state[CPU_IRQ][hot]);
+        wattroff(stdscr, COLOR_PAIR(cc) | A_BOLD);
+    }
+    y += 2;
+    int soft_rows = irq->nsoft < (ymax - y) / 2 - 1 ? irq->nsoft : (ymax - y) / 2 - 1;
+    y = draw_irq_srcs(y, y + 1 + soft_rows, px + 3, w, "SOFTIRQ", irq->soft_rate, irq->soft, irq->nsoft, 1);
+    if (y < ymax - 1) draw_irq_srcs(y + 1, ymax, px + 3, w, "IRQ", irq->hard_rate, irq->hard, irq->nhard, 0);
+}
+
+static int psi_color(double pct) {
+    if (pct < 5) return CLR_GREEN;
+    if (pct < g_alert_psi) return CLR_YELLOW;
+    return CLR_RED;
+}
+
+static void draw_psi_row(int y, int x, int w, const char *res, const char *kind, double rate, const double *avg) {
+    int pre = w >= 24 ? 12 : 6, aw = w >= 40 ? 18 : 0, bw = w - pre - 7 - aw;
+    if (pre == 12) mvwprintw(stdscr, y, x, "%-6s %-4s ", res, kind);
+    else mvwprintw(stdscr, y, x, "%-3.3s %c ", res, kind[0]);
+    if (bw > 0) draw_bar(stdscr, y, x + pre, bw, rate, psi_color(avg[0]));
+    int cc = psi_color(rate);
+    wattron(stdscr, COLOR_PAIR(cc) | A_BOLD); mvwprintw(stdscr, y, x + pre + (bw > 0 ? bw : 0), " %5.1f%%", rate); wattroff(stdscr, COLOR_PAIR(cc) | A_BOLD);
+    if (aw) { wattron(stdscr, COLOR_PAIR(CLR_DIM)); wprintw(stdscr, " %5.1f %5.1f %5.1f", avg[0], avg[1], avg[2]); wattroff(stdscr, COLOR_PAIR(CLR_DIM)); }
+}
+
+/* Bars are the share of time stalled since the previous read, which is
+ * sub-second after a trigger fires; the dim columns are the kernel's
+ * 10s/60s/300s averages. */
+void draw_psi_panel(int by, int top_h, int px, int pw, const sample_t *s) {
+    static const char *labels[PSI_NRES] = { "cpu", "mem", "io" };
+    draw_box(stdscr, by, px, top_h, pw, CLR_MAGENTA, "PRESSURE");
+    int y = by + 2, ymax = by + top_h - 1, x = px + 3, w = pw - 5;
+    int any = 0, armed = 0;
+    for (int r = 0; r < PSI_NRES; r++) {
+        any |= s->psi[r].present;
+        armed |= s->psi[r].trig_window_ms > 0;
+    }
+    if (!any) {
+        wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, y, x, "PSI not available"); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
+        return;
+    }
+
+    char tb[96];
+    int len = 0;
+    if (!armed) len = snprintf(tb, sizeof(tb), "triggers off, polling");
+    for (int r = 0; r < PSI_NRES; r++) {
+        const psi_t *p = &s->psi[r];
+        if (!p->trig_window_ms) continue;
+        if (!len) len = snprintf(tb, sizeof(tb), "trigger %dms/%gs", p->trig_stall_ms, p->trig_window_ms / 1000.0);
+        len += snprintf(tb + len, sizeof(tb) - len, " %s", labels[r]);
+    }
+    wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, y, x, "%.*s", w, tb); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
+    y += 2;
+
+    if (y < ymax && w >= 40) {
+        wattron(stdscr, COLOR_PAIR(CLR_DIM) | A_BOLD);
+        mvwprintw(stdscr, y++, x + w - 25, "%7s %5s %5s %5s", "NOW", "10s", "60s", "300s");
+        wattroff(stdscr, COLOR_PAIR(CLR_DIM) | A_BOLD);
+    }
+    for (int r = 0; r < PSI_NRES && y < ymax; r++) {
+        const psi_t *p = &s->psi[r];
+        if (!p->present) continue;
+        draw_psi_row(y++, x, w, labels[r], "some", p->some_rate, p->some);
+        if ((r != PSI_CPU || p->full_total) && y < ymax) draw_psi_row(y++, x, w, "", "full", p->full_rate, p->full);
+    }
+
+    if (!armed || ++y >= ymax) return;
+    wattron(stdscr, COLOR_PAIR(CLR_DIM)); mvwprintw(stdscr, y, x, "events"); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
+    int used = 6;
+    for (int r = 0; r < PSI_NRES; r++) {
+        const psi_t *p = &s->psi[r];
+        if (!p->trig_window_ms) continue;
+        double ago = s->wall - p->event_wall;
+        int hot = p->events && ago < PSI_ALERT_HOLD_S, cc = hot ? CLR_RED : CLR_WHITE;
+        char eb[32], ab[24] = "";
+        int n = snprintf(eb, sizeof(eb), " %s %u", labels[r], p->events);
+        if (used + n > w) break;
+        wattron(stdscr, COLOR_PAIR(cc) | (hot ? A_BOLD : 0)); wprintw(stdscr, "%s", eb); wattroff(stdscr, COLOR_PAIR(cc) | A_BOLD);
+        used += n;
+        if (!p->events) continue;
+        if (ago < 60) n = snprintf(ab, sizeof(ab), " (%.0fs ago)", ago);
+        else if (ago < 3600) n = snprintf(ab, sizeof(ab), " (%.0fm ago)", ago / 60);
+        else n = snprintf(ab, sizeof(ab), " (%.0fh ago)", ago / 3600);
+        if (used + n > w) continue;
+        wattron(stdscr, COLOR_PAIR(CLR_DIM)); wprintw(stdscr, "%s", ab); wattroff(stdscr, COLOR_PAIR(CLR_DIM));
+        used += n;
+    }
+}
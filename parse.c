@@ -0,0 +1,192 @@
+#include "parse.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define ONES 0x0101010101010101ULL
+#define LOW7 0x7f7f7f7f7f7f7f7fULL
+
+/* 0x80 in every byte of w equal to c (c repeated in each byte), exactly. */
+static inline uint64_t byte_eq(uint64_t w, uint64_t c) {
+    uint64_t x = w ^ c;
+    return ~(((x & LOW7) + LOW7) | x | LOW7);
+}
+
+/* Skips n single-space separators, as in /proc/<pid>/stat after the comm
+ * field, and returns the start of the field after the nth. Eight bytes are
+ * tested at a time: whole words are skipped while they hold fewer spaces
+ * than remain, and the word holding the last one is resolved with ctz.
+ * Anything near end or a NUL goes byte by byte. */
+const char *skip_fields(const char *p, const char *end, int n) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (n > 0 && end - p >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        if (byte_eq(w, 0)) break;
+        uint64_t m = byte_eq(w, ONES * ' ');
+        int spaces = (int)(((m >> 7) * ONES) >> 56);
+        if (spaces < n) {
+            n -= spaces;
+            p += 8;
+            continue;
+        }
+        while (--n) m &= m - 1;
+        return p + (__builtin_ctzll(m) >> 3) + 1;
+    }
+#endif
+    for (; n > 0 && p < end && *p; p++)
+        if (*p == ' ') n--;
+    return p;
+}
+
+/* 0x80 in every byte of w that is a blank or a decimal digit. */
+static inline uint64_t blank_or_digit(uint64_t w) {
+    uint64_t x = w ^ (ONES * '0');
+    uint64_t digit = ~(((x & LOW7) + ONES * (0x80 - 10)) | x) & (ONES * 0x80);
+    return digit | byte_eq(w, ONES * ' ');
+}
+
+/* Eight ASCII digits, most significant first; blanks read as zeros. */
+static inline uint32_t eight_digits(uint64_t w) {
+    w &= ONES * 15;
+    w = (w * 10 + (w >> 8)) & 0x00ff00ff00ff00ffULL;
+    w = (w * 100 + (w >> 16)) & 0x0000ffff0000ffffULL;
+    return (uint32_t)(w * 10000 + (w >> 32));
+}
+
+/* Count columns of /proc/interrupts and /proc/softirqs, p being just past
+ * the row's colon. The kernel prints each count as " %10u", so column j
+ * is the ten bytes at p + 11 * j + 1 and needs no search for its end: the
+ * low eight bytes are checked and converted as one word, the top two on
+ * their own. Blanks must be leading, which in the word means its blank
+ * bytes, widened to 0xff, form a low mask. A column of any other shape (a short row such as ERR, text
+ * after the last count) hands the rest of the row to the cursor scanner.
+ * Returns the number of columns parsed. */
+int scan_cols(const char *p, const char *end, uint32_t *out, int max) {
+    int j = 0;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (; j < max && end - p >= 12; j++, p += 11) {
+        uint64_t w;
+        memcpy(&w, p + 3, 8);
+        uint64_t top;
+        memcpy(&top, p, 8);
+        uint64_t blanks = (byte_eq(w, ONES * ' ') >> 7) * 0xff;
+        if ((blank_or_digit(w) != ONES * 0x80) | ((blank_or_digit(top) & 0x808000) != 0x808000) |
+            (p[0] != ' ') | ((unsigned)(p[10] - '0') >= 10) | ((p[11] != ' ') & (p[11] != '\n')) |
+            ((blanks & (blanks + 1)) != 0) | ((p[2] != ' ') & (blanks != 0)) | ((p[1] != ' ') & (p[2] == ' '))) break;
+        out[j] = ((p[1] & 15) * 10 + (p[2] & 15)) * 100000000U + eight_digits(w);
+    }
+#endif
+    for (; j < max; j++) {
+        unsigned long long v;
+        if (!scan_u64_n(&p, &v)) break;
+        out[j] = (uint32_t)v;
+    }
+    return j;
+}
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+/* 0x80 in every byte of w that is not a decimal digit. */
+static inline uint64_t non_digit(uint64_t w) {
+    uint64_t x = w ^ (ONES * '0');
+    return (((x & LOW7) + ONES * (0x80 - 10)) | x) & (ONES * 0x80);
+}
+
+/* Bit i set where p[i] is a space, for the n bytes at p, n a multiple of
+ * 16 up to 64. */
+static inline uint64_t space_bits(const char *p, int n) {
+    uint64_t m = 0;
+#ifdef __SSE2__
+    const __m128i sp = _mm_set1_epi8(' ');
+#pragma GCC unroll 4
+    for (int k = 0; k < n; k += 16)
+        m |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + k)), sp)) << k;
+#else
+#pragma GCC unroll 8
+    for (int k = 0; k < n; k += 8) {
+        uint64_t w;
+        memcpy(&w, p + k, 8);
+        m |= ((byte_eq(w, ONES * ' ') >> 7) * 0x0102040810204080ULL >> 56) << k;
+    }
+#endif
+    return m;
+}
+
+static inline uint64_t drop_low_bits(uint64_t m, int n) {
+#pragma GCC unroll 16
+    for (int i = 0; i < n; i++) m &= m - 1;
+    return m;
+}
+
+/* The len (1 to 16) bytes at q as a decimal, converted eight at a time;
+ * 0 if any of them is not a digit. */
+static inline int digits_n(const char *q, int len, unsigned long long *out) {
+    int hi = len > 8 ? len - 8 : 0, lo = len - hi;
+    uint64_t w;
+    memcpy(&w, q + hi, 8);
+    if (non_digit(w) & (~0ULL >> (64 - 8 * lo))) return 0;
+    unsigned long long v = eight_digits(w << (64 - 8 * lo));
+    if (hi) {
+        memcpy(&w, q, 8);
+        if (non_digit(w) & (~0ULL >> (64 - 8 * hi))) return 0;
+        v += eight_digits(w << (64 - 8 * hi)) * 100000000ULL;
+    }
+    *out = v;
+    return 1;
+}
+#endif
+
+/* utime, stime and starttime from /proc/<pid>/stat, p being the state
+ * field after "comm) ". Same result as skip_fields to field 11, two
+ * scan_u64, skip_fields 7 more and a third scan_u64, but in one pass: the
+ * spaces of the 64 bytes at p are a bitmask whose 11th, 12th and 13th set
+ * bits bound utime and stime, 32 more bytes from stime locate starttime,
+ * and the three digit runs are converted a word at a time. Lines where
+ * that does not hold (short, long or non-digit fields) take the cursor
+ * path. p..end must hold no NUL, which procfs never writes. */
+void scan_pidstat(const char *p, const char *end, unsigned long long *utime, unsigned long long *stime,
+                  unsigned long long *start) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (end - p >= 128) {
+        uint64_t m = drop_low_bits(space_bits(p, 64), 10);
+        int a = __builtin_ctzll(m | 1ULL << 63);
+        m &= m - 1;
+        int b = __builtin_ctzll(m | 1ULL << 63);
+        m &= m - 1;
+        int c = __builtin_ctzll(m | 1ULL << 63);
+        const char *s = p + b + 1;
+        uint64_t m2 = drop_low_bits(space_bits(s, 32), 6) | 1ULL << 40;
+        int d = __builtin_ctzll(m2);
+        m2 &= m2 - 1;
+        int e = __builtin_ctzll(m2);
+        if (c < 63 && e < 40 && (unsigned)(b - a - 2) < 16 && (unsigned)(c - b - 2) < 16 &&
+            (unsigned)(e - d - 2) < 16 && digits_n(p + a + 1, b - a - 1, utime) &
+            digits_n(s, c - b - 1, stime) & digits_n(s + d + 1, e - d - 1, start))
+            return;
+    }
+#endif
+    p = skip_fields(p, end, 11);
+    *utime = scan_u64(&p);
+    *stime = scan_u64(&p);
+    p = skip_fields(p, end, 7);
+    *start = scan_u64(&p);
+}
+
+/* Perfect hash over the meminfo keys read_mem needs: (first + last char
+ * + 6 * len) & 7 is distinct for all six, and one memcmp rejects the
+ * fifty-odd other keys. */
+static const struct { const char *key; unsigned char len, id; } mi_table[8] = {
+    [0] = { "SwapFree", 8, MI_SWAP_FREE },
+    [1] = { "MemTotal", 8, MI_TOTAL },
+    [2] = { "MemAvailable", 12, MI_AVAIL },
+    [3] = { "Cached", 6, MI_CACHED },
+    [5] = { "SwapTotal", 9, MI_SWAP_TOTAL },
+    [7] = { "Buffers", 7, MI_BUFFERS },
+};
+
+int meminfo_key(const char *key, size_t len) {
+    if (!len) return -1;
+    unsigned h = ((unsigned char)key[0] + (unsigned char)key[len - 1] + 6 * (unsigned)len) & 7;
+    if (mi_table[h].len != len || memcmp(mi_table[h].key, key, len) != 0) return -1;
+    return mi_table[h].id;
+}
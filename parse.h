@@ -0,0 +1,91 @@
+#ifndef PARSE_H
+#define PARSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Cursor scanners for procfs/sysfs text. Each skips leading blanks,
+ * consumes one field and leaves *cur just past it. No locale, errno or
+ * allocation; overflow wraps, which procfs counters never reach. */
+
+static inline const char *skip_blanks(const char *p) {
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+/* Returns 0 when no digits were found, leaving *out untouched. */
+static inline int scan_u64_n(const char **cur, unsigned long long *out) {
+    const char *p = skip_blanks(*cur), *start = p;
+    unsigned long long v = 0;
+    while ((unsigned)(*p - '0') < 10) v = v * 10 + (unsigned)(*p++ - '0');
+    *cur = p;
+    if (p == start) return 0;
+    *out = v;
+    return 1;
+}
+
+static inline unsigned long long scan_u64(const char **cur) {
+    unsigned long long v = 0;
+    scan_u64_n(cur, &v);
+    return v;
+}
+
+static inline long long scan_i64(const char **cur) {
+    const char *p = skip_blanks(*cur);
+    int neg = *p == '-';
+    if (neg || *p == '+') p++;
+    long long v = (unsigned)(*p - '0') < 10 ? (long long)scan_u64(&p) : 0;
+    *cur = p;
+    return neg ? -v : v;
+}
+
+/* Plain decimals only ("12.34", "-0.5"); no exponents, inf or nan. */
+static inline int scan_f64_n(const char **cur, double *out) {
+    const char *p = skip_blanks(*cur);
+    int neg = *p == '-';
+    if (neg || *p == '+') p++;
+    unsigned long long ip = 0, fp = 0;
+    int any = (unsigned)(*p - '0') < 10 && scan_u64_n(&p, &ip);
+    double scale = 1;
+    if (*p == '.') {
+        p++;
+        while ((unsigned)(*p - '0') < 10) {
+            if (scale < 1e18) { fp = fp * 10 + (unsigned)(*p - '0'); scale *= 10; }
+            p++;
+            any = 1;
+        }
+    }
+    *cur = p;
+    if (!any) return 0;
+    double v = ip + fp / scale;
+    *out = neg ? -v : v;
+    return 1;
+}
+
+static inline double scan_f64(const char **cur) {
+    double v = 0;
+    scan_f64_n(cur, &v);
+    return v;
+}
+
+/* Copies one blank-delimited token, truncated to sz - 1; returns its full length. */
+static inline size_t scan_word(const char **cur, char *out, size_t sz) {
+    const char *p = skip_blanks(*cur), *start = p;
+    while (*p && *p != ' ' && *p != '\t' && *p != '\n') p++;
+    size_t len = (size_t)(p - start), n = len < sz ? len : sz - 1;
+    memcpy(out, start, n);
+    out[n] = 0;
+    *cur = p;
+    return len;
+}
+
+const char *skip_fields(const char *p, const char *end, int n);
+void scan_pidstat(const char *p, const char *end, unsigned long long *utime, unsigned long long *stime,
+                  unsigned long long *start);
+int scan_cols(const char *p, const char *end, uint32_t *out, int max);
+
+enum { MI_TOTAL, MI_AVAIL, MI_BUFFERS, MI_CACHED, MI_SWAP_TOTAL, MI_SWAP_FREE, MI_COUNT };
+int meminfo_key(const char *key, size_t len);
+
+#endif
@@ -0,0 +1,148 @@
+#include "cutedash.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+/* Log-linear histogram: four sub-buckets per power of two of nanoseconds,
+ * so quantiles are within ~12% and recording is a clz and an increment. */
+#define PROF_BUCKETS 160
+#define PROF_MAX_STAGES 32
+#define PROF_WINDOW_NS 60000000000ULL
+
+/* Each stage keeps the current and the previous minute, so quantiles
+ * follow recent behaviour instead of averaging over the whole run. */
+typedef struct {
+    const char *name;
+    uint64_t since;
+    uint32_t n_cur, n_prev;
+    uint32_t cur[PROF_BUCKETS], prev[PROF_BUCKETS];
+} prof_stage_t;
+
+static prof_stage_t stages[PROF_MAX_STAGES];
+static int nstages;
+static pthread_mutex_t prof_mu = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long prof_ticks;
+
+uint64_t prof_clock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+int prof_stage(const char *name) {
+    pthread_mutex_lock(&prof_mu);
+    int id = 0;
+    while (id < nstages && strcmp(stages[id].name, name) != 0) id++;
+    if (id == nstages) {
+        if (nstages == PROF_MAX_STAGES) id = PROF_MAX_STAGES - 1;
+        else stages[nstages++].name = name;
+    }
+    pthread_mutex_unlock(&prof_mu);
+    return id;
+}
+
+static int bucket_of(uint64_t ns) {
+    if (ns < 4) return (int)ns;
+    int lg = 63 - __builtin_clzll(ns);
+    int b = lg * 4 + (int)((ns >> (lg - 2)) & 3);
+    return b < PROF_BUCKETS ? b : PROF_BUCKETS - 1;
+}
+
+static double bucket_ns(int b) {
+    if (b < 4) return b;
+    return (double)(1ULL << (b / 4)) * (1.0 + (b % 4 + 0.5) / 4.0);
+}
+
+void prof_record(int stage, uint64_t ns) {
+    if (stage < 0 || stage >= PROF_MAX_STAGES) return;
+    uint64_t now = prof_clock();
+    pthread_mutex_lock(&prof_mu);
+    prof_stage_t *s = &stages[stage];
+    if (now - s->since > PROF_WINDOW_NS) {
+        memcpy(s->prev, s->cur, sizeof(s->prev));
+        memset(s->cur, 0, sizeof(s->cur));
+        s->n_prev = s->n_cur;
+        s->n_cur = 0;
+        s->since = now;
+    }
+    s->cur[bucket_of(ns)]++;
+    s->n_cur++;
+    pthread_mutex_unlock(&prof_mu);
+}
+
+void prof_tick(void) {
+    __atomic_fetch_add(&prof_ticks, 1, __ATOMIC_RELAXED);
+}
+
+int prof_count(void) {
+    return nstages;
+}
+
+/* Fills name, sample count and p50/p99 in nanoseconds for one stage. */
+int prof_quantiles(int stage, const char **name, unsigned *n, double *p50, double *p99) {
+    if (stage < 0 || stage >= nstages) return -1;
+    pthread_mutex_lock(&prof_mu);
+    const prof_stage_t *s = &stages[stage];
+    *name = s->name;
+    *n = s->n_cur + s->n_prev;
+    *p50 = *p99 = 0;
+    unsigned want50 = (*n + 1) / 2, want99 = *n - *n / 100, seen = 0;
+    for (int b = 0; b < PROF_BUCKETS && *n; b++) {
+        unsigned c = s->cur[b] + s->prev[b];
+        if (!c) continue;
+        if (seen < want50 && seen + c >= want50) *p50 = bucket_ns(b);
+        seen += c;
+        if (seen >= want99) { *p99 = bucket_ns(b); break; }
+    }
+    pthread_mutex_unlock(&prof_mu);
+    return 0;
+}
+
+static int read_self(const char *path, char *buf, size_t sz) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t n = read(fd, buf, sz - 1);
+    close(fd);
+    if (n <= 0) return -1;
+    buf[n] = 0;
+    return 0;
+}
+
+static double self_field(const char *buf, const char *key) {
+    const char *p = strstr(buf, key);
+    return p ? strtod(p + strlen(key), NULL) : -1;
+}
+
+/* /proc/self/io counts only read- and write-class syscalls, which is
+ * nearly everything a procfs reader does; opens and closes are not seen.
+ * Rates cover the time since the previous refresh, which happens at most
+ * every min_s seconds; the first call only sets the baseline. */
+void prof_self(prof_self_t *out, double min_s) {
+    static prof_self_t last;
+    static uint64_t at;
+    static double cpu_s, sys_calls;
+    static unsigned long ticks;
+    uint64_t now = prof_clock();
+    if (at && now - at < min_s * 1e9) { *out = last; return; }
+
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    double cpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+    char buf[2048];
+    double calls = -1;
+    if (read_self("/proc/self/io", buf, sizeof(buf)) == 0) calls = self_field(buf, "syscr: ") + self_field(buf, "syscw: ");
+    unsigned long t = __atomic_load_n(&prof_ticks, __ATOMIC_RELAXED);
+    if (at) {
+        double dt = (now - at) / 1e9;
+        last.cpu_pct = (cpu - cpu_s) / dt * 100.0;
+        last.syscalls_per_tick = t > ticks && calls >= 0 ? (calls - sys_calls) / (t - ticks) : -1;
+    } else {
+        last.cpu_pct = last.syscalls_per_tick = -1;
+    }
+    last.rss_kb = read_self("/proc/self/status", buf, sizeof(buf)) == 0 ? (long)self_field(buf, "VmRSS:") : -1;
+    cpu_s = cpu;
+    sys_calls = calls;
+    ticks = t;
+    at = now;
+    *out = last;
+}
@@ -1,402 +1,1824 @@
 #include "cutedash.h"
+#include "parse.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <linux/magic.h>
+#include <linux/netlink.h>
+#include <sys/wait.h>
 
-void read_cpu_stats(cpu_stat_t *stats, int *count) {
-    FILE *f = fopen("/proc/stat", "r");
-    if (!f) return;
-    char line[512];
-    *count = 0;
-    while (fgets(line, sizeof(line), f)) {
+typedef struct {
+    const char *path;
+    int fd;
+    char *buf;
+    size_t cap, len;
+} proc_file_t;
+
+/* Relative paths are under g_proc_root; cgroup files use absolute ones. */
+#define PROC_FILE(p) { p, -1, NULL, 0, 0 }
+
+static proc_file_t pf_stat = PROC_FILE("stat");
+static proc_file_t pf_meminfo = PROC_FILE("meminfo");
+static proc_file_t pf_netdev = PROC_FILE("net/dev");
+static proc_file_t pf_diskstats = PROC_FILE("diskstats");
+static proc_file_t pf_loadavg = PROC_FILE("loadavg");
+static proc_file_t pf_mounts = PROC_FILE("self/mounts");
+
+enum { CG_CPU, CG_MEM, CG_IO, CG_PIDS, CG_FREEZE, CG_FILES };
+
+static int root_open(const char *root, const char *path, int flags) {
+    char full[512];
+    if (path[0] == '/') return open(path, flags | O_CLOEXEC);
+    if ((size_t)snprintf(full, sizeof(full), "%s/%s", root, path) >= sizeof(full)) return -1;
+    return open(full, flags | O_CLOEXEC);
+}
+
+/* procfs/sysfs fill the whole buffer unless the file is larger, so a short
+ * pread is EOF and a steady-state tick costs exactly one syscall per file. */
+static char *pf_read(proc_file_t *pf) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (pf->fd < 0) pf->fd = root_open(g_proc_root, pf->path, O_RDONLY);
+        if (pf->fd < 0) return NULL;
+        size_t len = 0;
+        ssize_t n = 0;
+        for (;;) {
+            if (pf->cap - len < 512) {
+                size_t ncap = pf->cap ? pf->cap * 2 : 4096;
+                char *nb = realloc(pf->buf, ncap);
+                if (!nb) return NULL;
+                pf->buf = nb;
+                pf->cap = ncap;
+            }
+            size_t want = pf->cap - len - 1;
+            n = pread(pf->fd, pf->buf + len, want, (off_t)len);
+            if (n <= 0) break;
+            len += (size_t)n;
+            if ((size_t)n < want) break;
+        }
+        if (n >= 0) {
+            pf->buf[len] = 0;
+            pf->len = len;
+            return pf->buf;
+        }
+        close(pf->fd);
+        pf->fd = -1;
+    }
+    return NULL;
+}
+
+static char *next_line(char **cur) {
+    char *s = *cur;
+    if (!s || !*s) return NULL;
+    char *nl = strchr(s, '\n');
+    if (nl) { *nl = 0; *cur = nl + 1; }
+    else *cur = s + strlen(s);
+    return s;
+}
+
+/* One arena holds every field array; rows already parsed are carried over
+ * because /proc/stat may list more CPUs than the initial guess. */
+static int cpu_stat_reserve(cpu_stat_t *st, int need) {
+    if (need <= st->cap) return 0;
+    int ncap = st->cap ? st->cap * 2 : (int)sysconf(_SC_NPROCESSORS_CONF) + 1;
+    if (ncap < 8) ncap = 8;
+    while (ncap < need) ncap *= 2;
+    unsigned long long **f[] = { &st->user, &st->nice, &st->system, &st->idle, &st->iowait,
+                                 &st->irq, &st->softirq, &st->steal, &st->total, &st->busy };
+    int nf = (int)(sizeof(f) / sizeof(f[0]));
+    char *arena = malloc((size_t)ncap * (nf * sizeof(unsigned long long) + sizeof(int)));
+    if (!arena) return -1;
+    unsigned long long *p = (unsigned long long *)arena;
+    for (int k = 0; k < nf; k++, p += ncap) {
+        if (st->count) memcpy(p, *f[k], st->count * sizeof(*p));
+        *f[k] = p;
+    }
+    int *id = (int *)p;
+    if (st->count) memcpy(id, st->id, st->count * sizeof(int));
+    st->id = id;
+    free(st->arena);
+    st->arena = arena;
+    st->cap = ncap;
+    return 0;
+}
+
+void read_cpu_stats(cpu_stat_t *st) {
+    char *cur = pf_read(&pf_stat), *line;
+    if (!cur) return;
+    st->count = 0;
+    while ((line = next_line(&cur))) {
         if (strncmp(line, "cpu", 3) != 0) break;
-        cpu_stat_t *s = &stats[*count];
-        if (line[3] == ' ')
-            sscanf(line + 4, "%llu %llu %llu %llu %llu %llu %llu %llu",
-                   &s->user, &s->nice, &s->system, &s->idle,
-                   &s->iowait, &s->irq, &s->softirq, &s->steal);
-        else
-            sscanf(line + 3, "%*d %llu %llu %llu %llu %llu %llu %llu %llu",
-                   &s->user, &s->nice, &s->system, &s->idle,
-                   &s->iowait, &s->irq, &s->softirq, &s->steal);
-        s->total = s->user + s->nice + s->system + s->idle + s->iowait + s->irq + s->softirq + s->steal;
-        s->busy = s->total - s->idle - s->iowait;
-        (*count)++;
-        if (*count > MAX_CORES) break;
-    }
-    fclose(f);
-}
-
-double calc_cpu_pct(cpu_stat_t *cur, cpu_stat_t *prev) {
-    unsigned long long dt = cur->total - prev->total;
-    unsigned long long db = cur->busy - prev->busy;
-    if (dt == 0) return 0.0;
-    return (double)db / dt * 100.0;
+        if (cpu_stat_reserve(st, st->count + 1) != 0) break;
+        int i = st->count;
+        const char *p = line + 3;
+        st->id[i] = *p == ' ' ? -1 : (int)scan_u64(&p);
+        st->user[i] = scan_u64(&p); st->nice[i] = scan_u64(&p); st->system[i] = scan_u64(&p);
+        st->idle[i] = scan_u64(&p); st->iowait[i] = scan_u64(&p); st->irq[i] = scan_u64(&p);
+        st->softirq[i] = scan_u64(&p); st->steal[i] = scan_u64(&p);
+        st->total[i] = st->user[i] + st->nice[i] + st->system[i] + st->idle[i] +
+                       st->iowait[i] + st->irq[i] + st->softirq[i] + st->steal[i];
+        st->busy[i] = st->total[i] - st->idle[i] - st->iowait[i];
+        st->count++;
+    }
+}
+
+/* Same CPUs in the same rows, so per-row deltas are meaningful. */
+int cpu_stat_match(const cpu_stat_t *a, const cpu_stat_t *b) {
+    return a->count == b->count && memcmp(a->id, b->id, a->count * sizeof(int)) == 0;
+}
+
+/* Busy and per-state percentages of rows [row, row + n) in one pass;
+ * state k of row i goes to state[k * stride + i]. Per-tick jiffy deltas
+ * fit in an int, and a zero total delta means every other delta is zero
+ * too, so dt + !dt keeps the loop branch-free. Counters that step back
+ * (iowait does) clamp to 0. restrict and the cheap cost model let -O2
+ * vectorize the loop. */
+#define CPU_DELTA(f) (int)(c->f[r] - p->f[r])
+#define CPU_PCT(d) do { if (d < 0) d = 0; d##_pct[i] = (float)(d * scale); } while (0)
+__attribute__((optimize("vect-cost-model=cheap")))
+static void cpu_pct_rows(const cpu_stat_t *c, const cpu_stat_t *p, int row, int n, double *restrict busy,
+                         float *restrict us_pct, float *restrict sy_pct, float *restrict wa_pct,
+                         float *restrict hi_pct, float *restrict si_pct, float *restrict st_pct) {
+    for (int i = 0; i < n; i++) {
+        int r = row + i, dt = CPU_DELTA(total), div = dt + !dt;
+        int us = CPU_DELTA(user) + CPU_DELTA(nice), sy = CPU_DELTA(system), wa = CPU_DELTA(iowait);
+        int hi = CPU_DELTA(irq), si = CPU_DELTA(softirq), st = CPU_DELTA(steal);
+        double scale = 100.0 / div;
+        busy[i] = CPU_DELTA(busy) * scale;
+        CPU_PCT(us); CPU_PCT(sy); CPU_PCT(wa); CPU_PCT(hi); CPU_PCT(si); CPU_PCT(st);
+    }
+}
+#undef CPU_DELTA
+#undef CPU_PCT
+
+void calc_cpu_pct(const cpu_stat_t *cur, const cpu_stat_t *prev, int row, int n,
+                  double *busy, float *state, int stride) {
+    cpu_pct_rows(cur, prev, row, n, busy, state + CPU_USER * stride, state + CPU_SYSTEM * stride,
+                 state + CPU_IOWAIT * stride, state + CPU_IRQ * stride,
+                 state + CPU_SOFTIRQ * stride, state + CPU_STEAL * stride);
 }
 
 void read_mem(unsigned long *total, unsigned long *avail, unsigned long *used,
               unsigned long *buffers, unsigned long *cached,
               unsigned long *sw_total, unsigned long *sw_free) {
-    FILE *f = fopen("/proc/meminfo", "r");
-    if (!f) return;
-    char line[256];
+    char *cur = pf_read(&pf_meminfo), *line;
+    if (!cur) return;
+    unsigned long *dst[MI_COUNT] = { total, avail, buffers, cached, sw_total, sw_free };
+    unsigned found = 0;
     *total = *avail = *buffers = *cached = *sw_total = *sw_free = 0;
-    while (fgets(line, sizeof(line), f)) {
-        if (strncmp(line, "MemTotal:", 9) == 0) sscanf(line + 9, "%lu", total);
-        else if (strncmp(line, "MemAvailable:", 13) == 0) sscanf(line + 13, "%lu", avail);
-        else if (strncmp(line, "Buffers:", 8) == 0) sscanf(line + 8, "%lu", buffers);
-        else if (strncmp(line, "Cached:", 7) == 0) sscanf(line + 7, "%lu", cached);
-        else if (strncmp(line, "SwapTotal:", 10) == 0) sscanf(line + 10, "%lu", sw_total);
-        else if (strncmp(line, "SwapFree:", 9) == 0) sscanf(line + 9, "%lu", sw_free);
-    }
-    fclose(f);
+    while (found != (1u << MI_COUNT) - 1 && (line = next_line(&cur))) {
+        const char *colon = strchr(line, ':');
+        int k = colon ? meminfo_key(line, (size_t)(colon - line)) : -1;
+        if (k < 0) continue;
+        const char *p = colon + 1;
+        *dst[k] = (unsigned long)scan_u64(&p);
+        found |= 1u << k;
+    }
     *used = *total - *avail;
 }
 
-int read_temps(char labels[][32], double *temps, double *highs, double *crits, int max) {
-    int count = 0;
+typedef struct {
+    int fd;
+    char label[32];
+    double high, crit;
+} temp_sensor_t;
+
+typedef struct {
+    int fd;
+    char label[32];
+} fan_sensor_t;
+
+#define MAX_TEMP_SENSORS 64
+#define MAX_FAN_SENSORS 32
+#define HWMON_FALLBACK_RESCAN 60.0
+
+static temp_sensor_t temp_sensors[MAX_TEMP_SENSORS];
+static fan_sensor_t fan_sensors[MAX_FAN_SENSORS];
+static int n_temp_sensors, n_fan_sensors;
+static int hwmon_stale = 1;
+static int uevent_fd = -2;
+static double hwmon_scanned_at;
+
+static int read_sysfs_line(const char *path, char *buf, size_t sz) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t n = read(fd, buf, sz - 1);
+    close(fd);
+    if (n <= 0) return -1;
+    buf[n] = 0;
+    buf[strcspn(buf, "\n")] = 0;
+    return 0;
+}
+
+/* Labels, names and limits are static, so they are read once here; only
+ * the _input fds stay open and are re-read with pread every tick. */
+static void hwmon_scan(void) {
+    for (int i = 0; i < n_temp_sensors; i++) close(temp_sensors[i].fd);
+    for (int i = 0; i < n_fan_sensors; i++) close(fan_sensors[i].fd);
+    n_temp_sensors = n_fan_sensors = 0;
+    hwmon_stale = 0;
+    hwmon_scanned_at = mono_now();
+
     char path[512], buf[128];
-    DIR *hwmon = opendir("/sys/class/hwmon");
-    if (!hwmon) return 0;
+    char dir[400];
+    snprintf(dir, sizeof(dir), "%.380s/class/hwmon", g_sys_root);
+    DIR *hwmon = opendir(dir);
+    if (!hwmon) return;
     struct dirent *hd;
-    while ((hd = readdir(hwmon)) && count < max) {
+    while ((hd = readdir(hwmon))) {
         if (hd->d_name[0] == '.') continue;
-        char base[512];
-        snprintf(base, sizeof(base), "/sys/class/hwmon/%.200s", hd->d_name);
-        for (int i = 1; i < 20 && count < max; i++) {
-            snprintf(path, sizeof(path), "%.400s/temp%d_input", base, i);
-            FILE *f = fopen(path, "r");
-            if (!f) break;
-            if (fgets(buf, sizeof(buf), f)) temps[count] = atof(buf) / 1000.0;
-            fclose(f);
+        char base[512], chip[64] = "";
+        snprintf(base, sizeof(base), "%s/%.100s", dir, hd->d_name);
+        snprintf(path, sizeof(path), "%.400s/name", base);
+        int has_name = read_sysfs_line(path, chip, sizeof(chip)) == 0;
 
+        for (int i = 1; i < 20 && n_temp_sensors < MAX_TEMP_SENSORS; i++) {
+            snprintf(path, sizeof(path), "%.400s/temp%d_input", base, i);
+            int fd = open(path, O_RDONLY | O_CLOEXEC);
+            if (fd < 0) break;
+            temp_sensor_t *t = &temp_sensors[n_temp_sensors];
+            t->fd = fd;
             snprintf(path, sizeof(path), "%.400s/temp%d_label", base, i);
-            f = fopen(path, "r");
-            if (f) {
-                if (fgets(buf, sizeof(buf), f)) { buf[strcspn(buf, "\n")] = 0; snprintf(labels[count], 32, "%.31s", buf); }
-                fclose(f);
-            } else {
-                snprintf(path, sizeof(path), "%.400s/name", base);
-                f = fopen(path, "r");
-                if (f) {
-                    if (fgets(buf, sizeof(buf), f)) { buf[strcspn(buf, "\n")] = 0; snprintf(labels[count], 32, "%.24s #%d", buf, i); }
-                    fclose(f);
-                } else snprintf(labels[count], 32, "sensor%d", count);
-            }
-            highs[count] = crits[count] = 0;
+            if (read_sysfs_line(path, buf, sizeof(buf)) == 0) snprintf(t->label, 32, "%.31s", buf);
+            else if (has_name) snprintf(t->label, 32, "%.24s #%d", chip, i);
+            else snprintf(t->label, 32, "sensor%d", n_temp_sensors);
+            t->high = t->crit = 0;
             snprintf(path, sizeof(path), "%.400s/temp%d_max", base, i);
-            f = fopen(path, "r");
-            if (f) { if (fgets(buf, sizeof(buf), f)) highs[count] = atof(buf) / 1000.0; fclose(f); }
+            const char *v = buf;
+            if (read_sysfs_line(path, buf, sizeof(buf)) == 0) t->high = scan_i64(&v) / 1000.0;
             snprintf(path, sizeof(path), "%.400s/temp%d_crit", base, i);
-            f = fopen(path, "r");
-            if (f) { if (fgets(buf, sizeof(buf), f)) crits[count] = atof(buf) / 1000.0; fclose(f); }
-            count++;
+            v = buf;
+            if (read_sysfs_line(path, buf, sizeof(buf)) == 0) t->crit = scan_i64(&v) / 1000.0;
+            n_temp_sensors++;
+        }
+        for (int i = 1; i < 10 && n_fan_sensors < MAX_FAN_SENSORS; i++) {
+            snprintf(path, sizeof(path), "%.400s/fan%d_input", base, i);
+            int fd = open(path, O_RDONLY | O_CLOEXEC);
+            if (fd < 0) break;
+            fan_sensor_t *f = &fan_sensors[n_fan_sensors++];
+            f->fd = fd;
+            snprintf(path, sizeof(path), "%.400s/fan%d_label", base, i);
+            if (read_sysfs_line(path, buf, sizeof(buf)) == 0) snprintf(f->label, 32, "%.31s", buf);
+            else snprintf(f->label, 32, "Fan %d", i);
         }
     }
     closedir(hwmon);
+}
+
+static int uevent_open(void) {
+    int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if (fd < 0) return -1;
+    struct sockaddr_nl sa = { .nl_family = AF_NETLINK, .nl_groups = 1 };
+    if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) { close(fd); return -1; }
+    return fd;
+}
+
+/* Kernel uevents are "ACTION@DEVPATH\0KEY=VAL\0..."; any hwmon add or
+ * remove marks the registry stale. Without a netlink socket (e.g. in a
+ * restricted container) fall back to a slow periodic rescan. */
+static void hwmon_refresh(void) {
+    if (uevent_fd == -2) uevent_fd = uevent_open();
+    if (uevent_fd >= 0) {
+        char msg[4096];
+        ssize_t n;
+        while ((n = recv(uevent_fd, msg, sizeof(msg) - 1, 0)) > 0) {
+            msg[n] = 0;
+            if (strncmp(msg, "add@", 4) != 0 && strncmp(msg, "remove@", 7) != 0) continue;
+            for (ssize_t off = 0; off < n; off += strlen(msg + off) + 1)
+                if (strcmp(msg + off, "SUBSYSTEM=hwmon") == 0) hwmon_stale = 1;
+        }
+    } else if (mono_now() - hwmon_scanned_at > HWMON_FALLBACK_RESCAN) {
+        hwmon_stale = 1;
+    }
+    if (hwmon_stale) hwmon_scan();
+}
+
+static int pread_long(int fd, long *v) {
+    char buf[32];
+    ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) return -1;
+    buf[n] = 0;
+    const char *p = buf;
+    *v = (long)scan_i64(&p);
+    return 0;
+}
+
+int read_temps(char labels[][32], double *temps, double *highs, double *crits, int max) {
+    hwmon_refresh();
+    int count = 0;
+    for (int i = 0; i < n_temp_sensors && count < max; i++) {
+        long v;
+        if (pread_long(temp_sensors[i].fd, &v) != 0) { hwmon_stale = 1; continue; }
+        memcpy(labels[count], temp_sensors[i].label, 32);
+        temps[count] = v / 1000.0;
+        highs[count] = temp_sensors[i].high;
+        crits[count] = temp_sensors[i].crit;
+        count++;
+    }
     return count;
 }
 
 int read_fans(fan_info_t *fans, int max) {
+    hwmon_refresh();
     int count = 0;
-    char path[512], buf[128];
-    DIR *hwmon = opendir("/sys/class/hwmon");
-    if (!hwmon) return 0;
-    struct dirent *hd;
-    while ((hd = readdir(hwmon)) && count < max) {
-        if (hd->d_name[0] == '.') continue;
-        char base[512];
-        snprintf(base, sizeof(base), "/sys/class/hwmon/%.200s", hd->d_name);
-        for (int i = 1; i < 10 && count < max; i++) {
-            snprintf(path, sizeof(path), "%.400s/fan%d_input", base, i);
-            FILE *f = fopen(path, "r");
-            if (!f) break;
-            if (fgets(buf, sizeof(buf), f)) fans[count].rpm = atoi(buf);
-            fclose(f);
-
-            snprintf(path, sizeof(path), "%.400s/fan%d_label", base, i);
-            f = fopen(path, "r");
-            if (f) {
-                if (fgets(buf, sizeof(buf), f)) { buf[strcspn(buf, "\n")] = 0; snprintf(fans[count].label, 32, "%.31s", buf); }
-                fclose(f);
-            } else {
-                snprintf(fans[count].label, 32, "Fan %d", i);
-            }
-            count++;
-        }
+    for (int i = 0; i < n_fan_sensors && count < max; i++) {
+        long v;
+        if (pread_long(fan_sensors[i].fd, &v) != 0) { hwmon_stale = 1; continue; }
+        memcpy(fans[count].label, fan_sensors[i].label, 32);
+        fans[count].rpm = (int)v;
+        count++;
     }
-    closedir(hwmon);
     return count;
 }
 
+double mono_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
 int read_ifaces(iface_t *ifs, int max) {
-    FILE *f = fopen("/proc/net/dev", "r");
-    if (!f) return 0;
-    char line[512];
+    char *cur = pf_read(&pf_netdev), *line;
+    if (!cur) return 0;
+    double now = mono_now();
     int count = 0;
-    (void)fgets(line, sizeof(line), f);
-    (void)fgets(line, sizeof(line), f);
-    while (fgets(line, sizeof(line), f) && count < max) {
+    next_line(&cur);
+    next_line(&cur);
+    while ((line = next_line(&cur)) && count < max) {
         char *colon = strchr(line, ':');
         if (!colon) continue;
-        char iface[64] = {0};
-        int len = (int)(colon - line);
-        if (len > 63) len = 63;
-        strncpy(iface, line, len);
-        iface[len] = 0;
-        char *p = iface;
-        while (*p == ' ') p++;
-        if (strcmp(p, "lo") == 0) continue;
-
-        snprintf(ifs[count].name, 32, "%s", p);
-        unsigned long long r, t;
-        sscanf(colon + 1, "%llu %*u %*u %*u %*u %*u %*u %*u %llu", &r, &t);
+        const char *name = skip_blanks(line);
+        size_t len = (size_t)(colon - name);
+        if (len == 2 && memcmp(name, "lo", 2) == 0) continue;
+        if (len > 31) len = 31;
+        memcpy(ifs[count].name, name, len);
+        ifs[count].name[len] = 0;
+
+        const char *p = colon + 1;
+        unsigned long long r = scan_u64(&p), t;
+        for (int i = 0; i < 7; i++) scan_u64(&p);
+        t = scan_u64(&p);
         ifs[count].rx = r;
         ifs[count].tx = t;
+        ifs[count].ts = now;
+        ifs[count].rx_speed = ifs[count].tx_speed = 0;
 
         for (int i = 0; i < num_ifaces; i++) {
             if (strcmp(ifaces[i].name, ifs[count].name) == 0) {
-                ifs[count].rx_speed = (double)(r - ifaces[i].rx) / (REFRESH_MS / 1000.0);
-                ifs[count].tx_speed = (double)(t - ifaces[i].tx) / (REFRESH_MS / 1000.0);
+                double dt = now - ifaces[i].ts;
+                if (dt > 0) {
+                    ifs[count].rx_speed = (double)(r - ifaces[i].rx) / dt;
+                    ifs[count].tx_speed = (double)(t - ifaces[i].tx) / dt;
+                }
                 break;
             }
         }
         count++;
     }
-    fclose(f);
     return count;
 }
 
+static void disk_dev_update(disk_dev_t *d, const unsigned long long *f, double dt) {
+    if (dt > 0 && d->primed) {
+        unsigned long long rd = f[0] - d->rd_ios, wr = f[4] - d->wr_ios;
+        d->read_iops = rd / dt;
+        d->write_iops = wr / dt;
+        d->read_bps = (double)(f[2] - d->rd_sec) * 512 / dt;
+        d->write_bps = (double)(f[6] - d->wr_sec) * 512 / dt;
+        d->util = (double)(f[9] - d->io_ticks) / (dt * 10.0);
+        if (d->util > 100) d->util = 100;
+        d->await_ms = (rd + wr) ? (double)(f[3] - d->rd_ticks + f[7] - d->wr_ticks) / (rd + wr) : 0;
+        d->queue = (double)(f[10] - d->queue_ticks) / (dt * 1000.0);
+    }
+    d->rd_ios = f[0]; d->rd_sec = f[2]; d->rd_ticks = f[3];
+    d->wr_ios = f[4]; d->wr_sec = f[6]; d->wr_ticks = f[7];
+    d->io_ticks = f[9]; d->queue_ticks = f[10];
+    d->primed = 1;
+}
+
+/* The kernel marks partitions with a "partition" attribute in sysfs; name
+ * prefixes are not enough (mmcblk0boot0 is a disk, md10 is not md1's).
+ * Each name is looked up once, tracked or not, so a tick costs nothing. */
+static int disk_is_partition(const char *name) {
+    static struct { char name[32]; int part; } known[64];
+    static int nknown;
+    for (int i = 0; i < nknown; i++)
+        if (strcmp(known[i].name, name) == 0) return known[i].part;
+    char sysname[32], path[320];
+    snprintf(sysname, sizeof(sysname), "%s", name);
+    for (char *c = sysname; *c; c++)
+        if (*c == '/') *c = '!';
+    snprintf(path, sizeof(path), "%s/class/block/%s/partition", g_sys_root, sysname);
+    if (nknown == 64) nknown = 0;
+    snprintf(known[nknown].name, sizeof(known[nknown].name), "%s", name);
+    known[nknown].part = access(path, F_OK) == 0;
+    return known[nknown++].part;
+}
+
+/* The aggregate rates leave out partitions and device-mapper volumes,
+ * which would count the same I/O twice. */
 void read_disk_io(disk_io_t *dio) {
-    FILE *f = fopen("/proc/diskstats", "r");
-    if (!f) return;
-    char line[512];
+    char *cur = pf_read(&pf_diskstats), *line;
+    if (!cur) return;
+    double now = mono_now();
+    double dt = dio->prev_ts > 0 ? now - dio->prev_ts : 0;
     unsigned long long total_read = 0, total_write = 0;
-    while (fgets(line, sizeof(line), f)) {
-        unsigned int major, minor;
-        char devname[64];
-        unsigned long long rd_sectors, wr_sectors;
-        int n = sscanf(line, "%u %u %63s %*u %*u %llu %*u %*u %*u %llu",
-                       &major, &minor, devname, &rd_sectors, &wr_sectors);
-        if (n < 5) continue;
-        if (minor != 0) continue;
-        if (strncmp(devname, "loop", 4) == 0) continue;
-        if (strncmp(devname, "ram", 3) == 0) continue;
-        total_read += rd_sectors * 512;
-        total_write += wr_sectors * 512;
-    }
-    fclose(f);
-
-    if (dio->prev_read > 0) {
-        dio->read_speed = (double)(total_read - dio->prev_read) / (REFRESH_MS / 1000.0);
-        dio->write_speed = (double)(total_write - dio->prev_write) / (REFRESH_MS / 1000.0);
+    for (int i = 0; i < dio->ndev; i++) dio->dev[i].seen = 0;
+    while ((line = next_line(&cur))) {
+        unsigned long long major, minor;
+        char devname[32];
+        const char *p = line;
+        if (!scan_u64_n(&p, &major) || !scan_u64_n(&p, &minor) || !scan_word(&p, devname, sizeof(devname))) continue;
+        if (strncmp(devname, "loop", 4) == 0 || strncmp(devname, "ram", 3) == 0) continue;
+        unsigned long long f[11];
+        int nf = 0;
+        while (nf < 11 && scan_u64_n(&p, &f[nf])) nf++;
+        if (nf < 11) continue;
+
+        disk_dev_t *d = NULL;
+        for (int i = 0; i < dio->ndev; i++)
+            if (strcmp(dio->dev[i].name, devname) == 0) { d = &dio->dev[i]; break; }
+        int part = d ? d->partition : disk_is_partition(devname);
+        if (!part && strncmp(devname, "dm-", 3) != 0) {
+            total_read += f[2] * 512;
+            total_write += f[6] * 512;
+        }
+        if ((part && !g_disk_parts) || f[0] + f[4] == 0) continue;
+
+        if (!d) {
+            if (dio->ndev >= MAX_DISKS) continue;
+            d = &dio->dev[dio->ndev++];
+            memset(d, 0, sizeof(*d));
+            snprintf(d->name, sizeof(d->name), "%s", devname);
+            d->partition = part;
+        }
+        d->seen = 1;
+        disk_dev_update(d, f, dt);
+    }
+    int n = 0;
+    for (int i = 0; i < dio->ndev; i++)
+        if (dio->dev[i].seen) {
+            if (n != i) dio->dev[n] = dio->dev[i];
+            n++;
+        }
+    dio->ndev = n;
+
+    if (dt > 0) {
+        dio->read_speed = (double)(total_read - dio->prev_read) / dt;
+        dio->write_speed = (double)(total_write - dio->prev_write) / dt;
     }
+    dio->prev_ts = now;
     dio->prev_read = total_read;
     dio->prev_write = total_write;
+}
 
-    dio->read_hist[dio->hist_pos] = dio->read_speed;
-    dio->write_hist[dio->hist_pos] = dio->write_speed;
-    dio->hist_pos = (dio->hist_pos + 1) % HISTORY_LEN;
-    if (dio->hist_len < HISTORY_LEN) dio->hist_len++;
+int read_loadavg(double *l1, double *l5, double *l15) {
+    const char *p = pf_read(&pf_loadavg);
+    if (!p) return 0;
+    return scan_f64_n(&p, l1) && scan_f64_n(&p, l5) && scan_f64_n(&p, l15);
 }
 
-int read_procs_with_cpu(proc_info_t *procs, int max, unsigned long mem_total_kb,
-                        proc_info_t *prev, int prev_count) {
-    DIR *proc_dir = opendir("/proc");
-    if (!proc_dir) return 0;
-    int count = 0;
-    struct dirent *de;
-    long clk = sysconf(_SC_CLK_TCK);
-    long page_size = sysconf(_SC_PAGESIZE);
+static char mount_cache[MAX_MOUNTS][128];
+static int mount_cache_count = -1;
 
-    while ((de = readdir(proc_dir)) && count < max) {
-        if (!isdigit(de->d_name[0])) continue;
-        int pid = atoi(de->d_name);
-        char path[256], line[1024];
-
-        snprintf(path, sizeof(path), "/proc/%d/stat", pid);
-        FILE *f = fopen(path, "r");
-        if (!f) continue;
-        if (!fgets(line, sizeof(line), f)) { fclose(f); continue; }
-        fclose(f);
-
-        char *name_s = strchr(line, '(');
-        char *name_e = strrchr(line, ')');
-        if (!name_s || !name_e) continue;
-
-        procs[count].pid = pid;
-        int nlen = (int)(name_e - name_s - 1);
-        if (nlen > 63) nlen = 63;
-        memcpy(procs[count].name, name_s + 1, nlen);
-        procs[count].name[nlen] = 0;
-
-        unsigned long utime = 0, stime = 0;
-        char *p = name_e + 2;
-        int field = 0;
-        while (*p && field < 12) {
-            while (*p == ' ') p++;
-            if (field == 11) { utime = strtoul(p, &p, 10); }
-            else if (field == 12) { stime = strtoul(p, &p, 10); }
-            else { while (*p && *p != ' ') p++; }
-            field++;
+/* /proc/self/mounts raises POLLPRI when the mount table changes, so the
+ * list is only re-parsed after a mount or unmount. */
+int read_mounts(char mounts[][128], int max) {
+    int changed = mount_cache_count < 0;
+    if (!changed && pf_mounts.fd >= 0) {
+        struct pollfd p = { .fd = pf_mounts.fd, .events = POLLPRI };
+        changed = poll(&p, 1, 0) > 0 && (p.revents & (POLLPRI | POLLERR));
+    }
+    if (changed) {
+        char *cur = pf_read(&pf_mounts), *line;
+        if (!cur) return 0;
+        mount_cache_count = 0;
+        while ((line = next_line(&cur)) && mount_cache_count < MAX_MOUNTS) {
+            char dev[128], mount[128];
+            const char *p = line;
+            if (!scan_word(&p, dev, sizeof(dev)) || !scan_word(&p, mount, sizeof(mount))) continue;
+            if (strncmp(dev, "/dev/", 5) != 0 || strstr(dev, "loop") || strstr(mount, "/snap")) continue;
+            snprintf(mount_cache[mount_cache_count++], 128, "%s", mount);
         }
-        if (*p) stime = strtoul(p, NULL, 10);
-
-        unsigned long long proc_total_time = utime + stime;
-        FILE *uf = fopen("/proc/uptime", "r");
-        double uptime_sec = 0;
-        if (uf) { (void)fscanf(uf, "%lf", &uptime_sec); fclose(uf); }
-        unsigned long long sys_total = (unsigned long long)(uptime_sec * clk);
-
-        procs[count].cpu_pct = 0;
-        for (int i = 0; i < prev_count; i++) {
-            if (prev[i].pid == pid) {
-                unsigned long long dt = sys_total - prev[i].prev_total;
-                unsigned long long dp = proc_total_time - (prev[i].prev_utime + prev[i].prev_stime);
-                if (dt > 0)
-                    procs[count].cpu_pct = (double)dp / dt * 100.0 * num_cores;
-                break;
+    }
+    int count = mount_cache_count < max ? mount_cache_count : max;
+    memcpy(mounts, mount_cache, (size_t)count * 128);
+    return count;
+}
+
+#define MOUNT_TIMEOUT_MS 2000
+
+typedef struct {
+    char path[128];
+    double used, total;
+    int valid, hung;
+} mount_slot_t;
+
+/* statvfs runs on a worker thread. A worker stuck past MOUNT_TIMEOUT_MS is
+ * abandoned: its mount is flagged hung and skipped until the call returns,
+ * and a fresh worker takes over the remaining mounts. */
+static mount_slot_t mslots[MAX_MOUNTS];
+static int n_mslots;
+static pthread_mutex_t mount_mu = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t mount_go = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t mount_done = PTHREAD_COND_INITIALIZER;
+static unsigned mount_worker_id, mount_round;
+static int mount_pending, mount_busy, mount_worker_up;
+static char mount_busy_path[128];
+static double mount_busy_since;
+
+static mount_slot_t *mslot_find(const char *path) {
+    for (int i = 0; i < n_mslots; i++)
+        if (strcmp(mslots[i].path, path) == 0) return &mslots[i];
+    return NULL;
+}
+
+static void *mount_worker(void *arg) {
+    unsigned id = (unsigned)(uintptr_t)arg;
+    char path[128];
+    pthread_mutex_lock(&mount_mu);
+    for (;;) {
+        while (!mount_pending && id == mount_worker_id) pthread_cond_wait(&mount_go, &mount_mu);
+        if (id != mount_worker_id) break;
+        mount_pending = 0;
+        for (int i = 0; i < n_mslots; i++) {
+            if (mslots[i].hung) continue;
+            memcpy(path, mslots[i].path, sizeof(path));
+            memcpy(mount_busy_path, path, sizeof(path));
+            mount_busy = 1;
+            mount_busy_since = mono_now();
+            pthread_mutex_unlock(&mount_mu);
+
+            struct statvfs st;
+            int ok = statvfs(path, &st) == 0;
+
+            pthread_mutex_lock(&mount_mu);
+            mount_slot_t *m = mslot_find(path);
+            if (id != mount_worker_id) {
+                if (m) m->hung = 0;
+                pthread_mutex_unlock(&mount_mu);
+                return NULL;
+            }
+            mount_busy = 0;
+            if (m) {
+                m->valid = ok;
+                if (ok) {
+                    m->total = (double)st.f_blocks * st.f_frsize;
+                    m->used = m->total - (double)st.f_bfree * st.f_frsize;
+                }
             }
         }
-        procs[count].prev_total = sys_total;
-        procs[count].prev_utime = utime;
-        procs[count].prev_stime = stime;
-
-        unsigned long rss = 0;
-        snprintf(path, sizeof(path), "/proc/%d/statm", pid);
-        f = fopen(path, "r");
-        if (f) { unsigned long sz; (void)fscanf(f, "%lu %lu", &sz, &rss); fclose(f); }
-        double mem_kb = (double)rss * page_size / 1024.0;
-        procs[count].mem_pct = (mem_total_kb > 0) ? mem_kb / mem_total_kb * 100.0 : 0;
-        count++;
+        mount_round++;
+        pthread_cond_broadcast(&mount_done);
+    }
+    pthread_mutex_unlock(&mount_mu);
+    return NULL;
+}
+
+static int mount_worker_spawn(void) {
+    pthread_t t;
+    if (pthread_create(&t, NULL, mount_worker, (void *)(uintptr_t)mount_worker_id) != 0) return -1;
+    pthread_detach(t);
+    mount_worker_up = 1;
+    return 0;
+}
+
+/* Caller holds mount_mu. */
+static void mount_check_timeout(void) {
+    if (!mount_busy || (mono_now() - mount_busy_since) * 1000.0 < MOUNT_TIMEOUT_MS) return;
+    mount_slot_t *m = mslot_find(mount_busy_path);
+    if (m) m->hung = 1;
+    mount_busy = 0;
+    mount_worker_id++;
+    pthread_cond_broadcast(&mount_go);
+    mount_worker_up = 0;
+    if (mount_worker_spawn() == 0) mount_pending = 1;
+}
+
+/* Returns the results of the last completed statvfs round without blocking
+ * on the filesystems; wait_ms > 0 waits that long for a fresh round. */
+int read_disk_usage(mount_usage_t *mounts, int max, int wait_ms) {
+    char paths[MAX_MOUNTS][128];
+    int nm = read_mounts(paths, MAX_MOUNTS), count = 0;
+
+    pthread_mutex_lock(&mount_mu);
+    mount_slot_t old[MAX_MOUNTS];
+    int n_old = n_mslots;
+    memcpy(old, mslots, sizeof(old));
+    n_mslots = 0;
+    for (int i = 0; i < nm; i++) {
+        mount_slot_t *m = &mslots[n_mslots++];
+        memset(m, 0, sizeof(*m));
+        memcpy(m->path, paths[i], 128);
+        for (int j = 0; j < n_old; j++)
+            if (strcmp(old[j].path, paths[i]) == 0) { *m = old[j]; break; }
     }
-    closedir(proc_dir);
+    mount_check_timeout();
+    if (!mount_worker_up) mount_worker_spawn();
+    unsigned start = mount_round;
+    mount_pending = 1;
+    pthread_cond_broadcast(&mount_go);
+    double deadline = mono_now() + wait_ms / 1000.0;
+    while (mount_round == start && mono_now() < deadline) {
+        double until = mono_now() + 0.1;
+        if (until > deadline) until = deadline;
+        if (mount_busy && mount_busy_since + MOUNT_TIMEOUT_MS / 1000.0 < until)
+            until = mount_busy_since + MOUNT_TIMEOUT_MS / 1000.0;
+        double left = until - mono_now();
+        if (left < 0.001) left = 0.001;
+        struct timespec dl;
+        clock_gettime(CLOCK_REALTIME, &dl);
+        dl.tv_sec += (time_t)left;
+        dl.tv_nsec += (long)((left - (time_t)left) * 1e9);
+        if (dl.tv_nsec >= 1000000000L) { dl.tv_sec++; dl.tv_nsec -= 1000000000L; }
+        pthread_cond_timedwait(&mount_done, &mount_mu, &dl);
+        mount_check_timeout();
+    }
+
+    for (int i = 0; i < n_mslots && count < max; i++) {
+        if (!mslots[i].valid && !mslots[i].hung) continue;
+        mount_usage_t *m = &mounts[count++];
+        snprintf(m->path, sizeof(m->path), "%.127s", mslots[i].path);
+        m->total = mslots[i].total;
+        m->used = mslots[i].used;
+        m->unresponsive = mslots[i].hung;
+    }
+    pthread_mutex_unlock(&mount_mu);
     return count;
 }
 
-int proc_cmp_cpu(const void *a, const void *b) {
-    double da = ((const proc_info_t *)a)->cpu_pct, db = ((const proc_info_t *)b)->cpu_pct;
-    return (db > da) - (db < da);
+typedef struct {
+    int pid;
+    unsigned int gen;
+    unsigned long long starttime;
+    unsigned long long prev_total, prev_time;
+} proc_slot_t;
+
+static proc_slot_t *ptab;
+static size_t ptab_cap, ptab_used;
+static unsigned int ptab_gen;
+
+static size_t ptab_hash(int pid, unsigned long long starttime) {
+    unsigned long long h = ((unsigned long long)(unsigned)pid << 32) ^ starttime;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (size_t)h & (ptab_cap - 1);
+}
+
+static proc_slot_t *ptab_probe(int pid, unsigned long long starttime) {
+    size_t i = ptab_hash(pid, starttime);
+    while (ptab[i].pid && (ptab[i].pid != pid || ptab[i].starttime != starttime))
+        i = (i + 1) & (ptab_cap - 1);
+    return &ptab[i];
+}
+
+static int ptab_grow(void) {
+    proc_slot_t *old = ptab;
+    size_t old_cap = ptab_cap;
+    size_t ncap = old_cap ? old_cap * 2 : 1024;
+    proc_slot_t *nt = calloc(ncap, sizeof(*nt));
+    if (!nt) return -1;
+    ptab = nt;
+    ptab_cap = ncap;
+    for (size_t i = 0; i < old_cap; i++)
+        if (old[i].pid) *ptab_probe(old[i].pid, old[i].starttime) = old[i];
+    free(old);
+    return 0;
+}
+
+/* Backward-shift deletion keeps linear probe chains intact without tombstones. */
+static void ptab_sweep(void) {
+    size_t mask = ptab_cap - 1;
+    for (size_t i = 0; i < ptab_cap; i++) {
+        while (ptab[i].pid && ptab[i].gen != ptab_gen) {
+            size_t hole = i, j = i;
+            for (;;) {
+                j = (j + 1) & mask;
+                if (!ptab[j].pid) break;
+                size_t home = ptab_hash(ptab[j].pid, ptab[j].starttime);
+                if (((j - home) & mask) >= ((j - hole) & mask)) {
+                    ptab[hole] = ptab[j];
+                    hole = j;
+                }
+            }
+            ptab[hole].pid = 0;
+            ptab_used--;
+        }
+    }
+}
+
+static proc_slot_t *ptab_lookup(int pid, unsigned long long starttime, int *fresh) {
+    if ((ptab_used + 1) * 2 > ptab_cap && ptab_grow() != 0) return NULL;
+    proc_slot_t *s = ptab_probe(pid, starttime);
+    *fresh = !s->pid;
+    if (*fresh) {
+        s->pid = pid;
+        s->starttime = starttime;
+        ptab_used++;
+    }
+    s->gen = ptab_gen;
+    return s;
+}
+
+static int proc_table_reserve(proc_table_t *pt, int need) {
+    if (need <= pt->cap) return 0;
+    int ncap = pt->cap ? pt->cap : 1024;
+    while (ncap < need) ncap *= 2;
+    size_t row = sizeof(sort_key_t) + sizeof(int) + 2 * sizeof(double) + 2 * sizeof(uint32_t);
+    char *arena = malloc((size_t)ncap * row);
+    if (!arena) return -1;
+    sort_key_t *keys = (sort_key_t *)arena;
+    double *cpu = (double *)(keys + ncap);
+    double *mem = cpu + ncap;
+    int *pid = (int *)(mem + ncap);
+    uint32_t *name = (uint32_t *)(pid + ncap);
+    uint32_t *order = name + ncap;
+    if (pt->count) {
+        memcpy(cpu, pt->cpu_pct, pt->count * sizeof(double));
+        memcpy(mem, pt->mem_pct, pt->count * sizeof(double));
+        memcpy(pid, pt->pid, pt->count * sizeof(int));
+        memcpy(name, pt->name, pt->count * sizeof(uint32_t));
+    }
+    free(pt->arena);
+    pt->arena = arena;
+    pt->cpu_pct = cpu;
+    pt->mem_pct = mem;
+    pt->pid = pid;
+    pt->name = name;
+    pt->order = order;
+    pt->keys = keys;
+    pt->cap = ncap;
+    return 0;
+}
+
+int proc_table_copy(proc_table_t *dst, const proc_table_t *src) {
+    dst->count = 0;
+    dst->names_len = 0;
+    if (src->count == 0) return 0;
+    if (proc_table_reserve(dst, src->count) != 0) return -1;
+    if (dst->names_cap < src->names_len) {
+        char *nn = realloc(dst->names, src->names_len);
+        if (!nn) return -1;
+        dst->names = nn;
+        dst->names_cap = src->names_len;
+    }
+    memcpy(dst->pid, src->pid, src->count * sizeof(int));
+    memcpy(dst->cpu_pct, src->cpu_pct, src->count * sizeof(double));
+    memcpy(dst->mem_pct, src->mem_pct, src->count * sizeof(double));
+    memcpy(dst->name, src->name, src->count * sizeof(uint32_t));
+    memcpy(dst->names, src->names, src->names_len);
+    dst->names_len = src->names_len;
+    dst->count = src->count;
+    return 0;
+}
+
+static uint32_t fnv1a(const char *s, int len) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < len; i++) h = (h ^ (unsigned char)s[i]) * 16777619u;
+    return h;
+}
+
+/* Names are interned per scan: thousands of kworker/bash rows share one copy. */
+static int proc_table_intern(proc_table_t *pt, const char *s, int len, uint32_t *off) {
+    if (pt->intern_cap < (size_t)pt->cap * 2) {
+        size_t ncap = (size_t)pt->cap * 2;
+        uint32_t *ni = calloc(ncap, sizeof(uint32_t));
+        if (!ni) return -1;
+        free(pt->intern);
+        pt->intern = ni;
+        pt->intern_cap = ncap;
+        for (uint32_t r = 0; r < (uint32_t)pt->count; r++) {
+            const char *n = PROC_NAME(pt, r);
+            size_t i = fnv1a(n, (int)strlen(n)) & (ncap - 1);
+            while (pt->intern[i] && pt->intern[i] - 1 != pt->name[r]) i = (i + 1) & (ncap - 1);
+            pt->intern[i] = pt->name[r] + 1;
+        }
+    }
+    size_t mask = pt->intern_cap - 1;
+    size_t i = fnv1a(s, len) & mask;
+    while (pt->intern[i]) {
+        const char *n = pt->names + pt->intern[i] - 1;
+        if (strncmp(n, s, len) == 0 && n[len] == 0) { *off = pt->intern[i] - 1; return 0; }
+        i = (i + 1) & mask;
+    }
+    if (pt->names_len + len + 1 > pt->names_cap) {
+        size_t ncap = pt->names_cap ? pt->names_cap : 16384;
+        while (pt->names_len + len + 1 > ncap) ncap *= 2;
+        char *nn = realloc(pt->names, ncap);
+        if (!nn) return -1;
+        pt->names = nn;
+        pt->names_cap = ncap;
+    }
+    *off = (uint32_t)pt->names_len;
+    memcpy(pt->names + pt->names_len, s, len);
+    pt->names[pt->names_len + len] = 0;
+    pt->names_len += len + 1;
+    pt->intern[i] = *off + 1;
+    return 0;
+}
+
+void proc_table_clear(proc_table_t *pt) {
+    pt->count = 0;
+    pt->names_len = 0;
+    if (pt->intern) memset(pt->intern, 0, pt->intern_cap * sizeof(uint32_t));
+}
+
+int proc_table_push(proc_table_t *pt, int pid, double cpu, double mem, const char *name) {
+    if (proc_table_reserve(pt, pt->count + 1) != 0) return -1;
+    int r = pt->count;
+    if (proc_table_intern(pt, name, (int)strlen(name), &pt->name[r]) != 0) return -1;
+    pt->pid[r] = pid;
+    pt->cpu_pct[r] = cpu;
+    pt->mem_pct[r] = mem;
+    pt->count++;
+    return 0;
+}
+
+typedef struct {
+    int pid;
+    int nlen;
+    char name[64];
+    unsigned long long cputime, starttime;
+    unsigned long rss;
+} proc_raw_t;
+
+typedef struct {
+    pthread_t thread;
+    int lo, hi;
+    proc_raw_t *out;
+    int nout, cap;
+} scan_worker_t;
+
+#define MAX_SCAN_WORKERS 16
+#define PIDS_PER_WORKER 256
+
+static int proc_dirfd = -1;
+static char *dents;
+static size_t dents_cap;
+static const char **pid_names;
+static int pid_names_cap, npid_names;
+
+static scan_worker_t workers[MAX_SCAN_WORKERS];
+static int nworkers_started = 1;
+static int scan_active;
+static unsigned int scan_seq;
+static int scan_pending;
+static pthread_mutex_t scan_mu = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t scan_go = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t scan_done = PTHREAD_COND_INITIALIZER;
+
+static int read_at(const char *pid, const char *file, char *buf, size_t sz) {
+    char path[48];
+    size_t pl = strlen(pid);
+    if (pl > 20) return -1;
+    memcpy(path, pid, pl);
+    path[pl] = '/';
+    strcpy(path + pl + 1, file);
+    int fd = openat(proc_dirfd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t n = read(fd, buf, sz - 1);
+    close(fd);
+    if (n <= 0) return -1;
+    buf[n] = 0;
+    return (int)n;
 }
 
-int proc_cmp_mem(const void *a, const void *b) {
-    double da = ((const proc_info_t *)a)->mem_pct, db = ((const proc_info_t *)b)->mem_pct;
-    return (db > da) - (db < da);
+static int scan_one(const char *pid_s, proc_raw_t *r) {
+    char line[1024];
+    int n = read_at(pid_s, "stat", line, sizeof(line));
+    if (n < 0) return -1;
+    const char *end = line + n;
+    /* The kernel prints at most 63 bytes of comm and no ')' after it, so
+     * the last one in the line is within 65 bytes of the '('. */
+    char *name_s = memchr(line, '(', n);
+    char *name_e = name_s ? memrchr(name_s, ')', end - name_s < 65 ? end - name_s : 65) : NULL;
+    if (!name_e || name_e + 2 > end) return -1;
+
+    const char *p = pid_s;
+    r->pid = (int)scan_u64(&p);
+    r->nlen = (int)(name_e - name_s - 1);
+    if (r->nlen > 63) r->nlen = 63;
+    memcpy(r->name, name_s + 1, r->nlen);
+
+    unsigned long long utime, stime;
+    scan_pidstat(name_e + 2, end, &utime, &stime, &r->starttime);
+    r->cputime = utime + stime;
+
+    r->rss = 0;
+    if (read_at(pid_s, "statm", line, sizeof(line)) > 0) {
+        p = line;
+        scan_u64(&p);
+        r->rss = scan_u64(&p);
+    }
+    return 0;
 }
 
-int proc_cmp_pid(const void *a, const void *b) {
-    return ((const proc_info_t *)b)->pid - ((const proc_info_t *)a)->pid;
+static void scan_range(scan_worker_t *w) {
+    w->nout = 0;
+    for (int i = w->lo; i < w->hi; i++) {
+        if (w->nout == w->cap) {
+            int ncap = w->cap ? w->cap * 2 : 512;
+            proc_raw_t *no = realloc(w->out, ncap * sizeof(*no));
+            if (!no) return;
+            w->out = no;
+            w->cap = ncap;
+        }
+        if (scan_one(pid_names[i], &w->out[w->nout]) == 0) w->nout++;
+    }
+}
+
+static void *scan_worker_main(void *arg) {
+    scan_worker_t *w = arg;
+    unsigned int seen = 0;
+    for (;;) {
+        pthread_mutex_lock(&scan_mu);
+        while (scan_seq == seen || w - workers >= scan_active)
+            pthread_cond_wait(&scan_go, &scan_mu);
+        seen = scan_seq;
+        pthread_mutex_unlock(&scan_mu);
+
+        scan_range(w);
+
+        pthread_mutex_lock(&scan_mu);
+        if (--scan_pending == 0) pthread_cond_signal(&scan_done);
+        pthread_mutex_unlock(&scan_mu);
+    }
+    return NULL;
+}
+
+static int list_pids(void) {
+    if (proc_dirfd < 0) proc_dirfd = open(g_proc_root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (proc_dirfd < 0) return -1;
+    if (lseek(proc_dirfd, 0, SEEK_SET) < 0) return -1;
+    size_t len = 0;
+    for (;;) {
+        if (dents_cap - len < 65536) {
+            size_t ncap = dents_cap ? dents_cap * 2 : 262144;
+            char *nb = realloc(dents, ncap);
+            if (!nb) return -1;
+            dents = nb;
+            dents_cap = ncap;
+        }
+        ssize_t n = getdents64(proc_dirfd, dents + len, dents_cap - len);
+        if (n < 0) return -1;
+        if (n == 0) break;
+        len += (size_t)n;
+    }
+    npid_names = 0;
+    for (size_t off = 0; off < len;) {
+        struct dirent64 *d = (struct dirent64 *)(dents + off);
+        off += d->d_reclen;
+        if (!isdigit((unsigned char)d->d_name[0])) continue;
+        if (npid_names == pid_names_cap) {
+            int ncap = pid_names_cap ? pid_names_cap * 2 : 4096;
+            const char **nn = realloc(pid_names, ncap * sizeof(*nn));
+            if (!nn) return -1;
+            pid_names = nn;
+            pid_names_cap = ncap;
+        }
+        pid_names[npid_names++] = d->d_name;
+    }
+    return npid_names;
+}
+
+static int scan_worker_count(int npids) {
+    int n = g_scan_workers;
+    if (n <= 0) {
+        n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (n > 4) n = 4;
+    }
+    if (n > MAX_SCAN_WORKERS) n = MAX_SCAN_WORKERS;
+    int by_load = (npids + PIDS_PER_WORKER - 1) / PIDS_PER_WORKER;
+    if (n > by_load) n = by_load;
+    return n < 1 ? 1 : n;
+}
+
+/* Worker 0 is the calling thread; helpers are spawned lazily and parked
+ * on scan_go between ticks. Each worker owns its output buffer, so the
+ * merge below needs no locking. */
+static int scan_pids(int nw) {
+    while (nworkers_started < nw) {
+        scan_worker_t *w = &workers[nworkers_started];
+        if (pthread_create(&w->thread, NULL, scan_worker_main, w) != 0) break;
+        nworkers_started++;
+    }
+    if (nw > nworkers_started) nw = nworkers_started;
+    int per = (npid_names + nw - 1) / nw;
+    for (int i = 0; i < nw; i++) {
+        workers[i].lo = i * per < npid_names ? i * per : npid_names;
+        workers[i].hi = workers[i].lo + per < npid_names ? workers[i].lo + per : npid_names;
+    }
+    if (nw > 1) {
+        pthread_mutex_lock(&scan_mu);
+        scan_active = nw;
+        scan_pending = nw - 1;
+        scan_seq++;
+        pthread_cond_broadcast(&scan_go);
+        pthread_mutex_unlock(&scan_mu);
+    }
+    scan_range(&workers[0]);
+    if (nw > 1) {
+        pthread_mutex_lock(&scan_mu);
+        while (scan_pending > 0) pthread_cond_wait(&scan_done, &scan_mu);
+        pthread_mutex_unlock(&scan_mu);
+    }
+    return nw;
+}
+
+static proc_file_t pf_uptime = PROC_FILE("uptime");
+
+int read_procs_with_cpu(proc_table_t *pt, unsigned long mem_total_kb) {
+    pt->count = 0;
+    int npids = list_pids();
+    if (npids < 0) return 0;
+    long clk = sysconf(_SC_CLK_TCK);
+    long page_size = sysconf(_SC_PAGESIZE);
+
+    const char *up = pf_read(&pf_uptime);
+    double uptime_sec = up ? scan_f64(&up) : 0;
+    unsigned long long sys_total = (unsigned long long)(uptime_sec * clk);
+
+    int nw = scan_pids(scan_worker_count(npids));
+
+    ptab_gen++;
+    proc_table_clear(pt);
+
+    for (int w = 0; w < nw; w++) {
+        for (int k = 0; k < workers[w].nout; k++) {
+            const proc_raw_t *raw = &workers[w].out[k];
+            if (proc_table_reserve(pt, pt->count + 1) != 0) goto done;
+            int r = pt->count;
+            if (proc_table_intern(pt, raw->name, raw->nlen, &pt->name[r]) != 0) goto done;
+            pt->pid[r] = raw->pid;
+
+            pt->cpu_pct[r] = 0;
+            int fresh;
+            proc_slot_t *slot = ptab_lookup(raw->pid, raw->starttime, &fresh);
+            if (slot) {
+                if (!fresh && sys_total > slot->prev_total)
+                    pt->cpu_pct[r] = (double)(raw->cputime - slot->prev_time) /
+                                     (sys_total - slot->prev_total) * 100.0 * num_cores;
+                slot->prev_total = sys_total;
+                slot->prev_time = raw->cputime;
+            }
+
+            double mem_kb = (double)raw->rss * page_size / 1024.0;
+            pt->mem_pct[r] = (mem_total_kb > 0) ? mem_kb / mem_total_kb * 100.0 : 0;
+            pt->count++;
+        }
+    }
+done:
+    if (ptab) ptab_sweep();
+    return pt->count;
+}
+
+static inline int key_before(const sort_key_t *a, const sort_key_t *b) {
+    return a->key > b->key || (a->key == b->key && a->idx < b->idx);
+}
+
+static int key_cmp(const void *a, const void *b) {
+    return key_before(b, a) - key_before(a, b);
+}
+
+static void key_swap(sort_key_t *a, sort_key_t *b) {
+    sort_key_t t = *a; *a = *b; *b = t;
+}
+
+/* Quickselect: afterwards keys[0..k) hold the k largest, in no order.
+ * The idx tie-break makes every key distinct so Lomuto partitioning
+ * stays linear even when most processes sit at 0% CPU. */
+static void select_top(sort_key_t *keys, int n, int k) {
+    int lo = 0, hi = n - 1;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (key_before(&keys[mid], &keys[lo])) key_swap(&keys[mid], &keys[lo]);
+        if (key_before(&keys[hi], &keys[lo])) key_swap(&keys[hi], &keys[lo]);
+        if (key_before(&keys[mid], &keys[hi])) key_swap(&keys[mid], &keys[hi]);
+        sort_key_t pivot = keys[hi];
+        int store = lo;
+        for (int i = lo; i < hi; i++)
+            if (key_before(&keys[i], &pivot)) key_swap(&keys[i], &keys[store++]);
+        key_swap(&keys[store], &keys[hi]);
+        if (store == k - 1 || store == k) return;
+        if (store < k) lo = store + 1;
+        else hi = store - 1;
+    }
+}
+
+void sort_procs(proc_table_t *pt, int sort, int k) {
+    int n = pt->count;
+    if (k > n) k = n;
+    if (k < 0) k = 0;
+    const double *src = sort == SORT_CPU ? pt->cpu_pct : sort == SORT_MEM ? pt->mem_pct : NULL;
+    for (int i = 0; i < n; i++) {
+        pt->keys[i].key = src ? src[i] : pt->pid[i];
+        pt->keys[i].idx = (uint32_t)i;
+    }
+    if (k < n) select_top(pt->keys, n, k);
+    qsort(pt->keys, k, sizeof(sort_key_t), key_cmp);
+    for (int i = 0; i < k; i++) pt->order[i] = pt->keys[i].idx;
+    pt->ntop = k;
 }
 
 battery_t read_battery(void) {
     battery_t bat = {0};
-    FILE *f;
-    char buf[128];
-
-    f = fopen("/sys/class/power_supply/BAT0/present", "r");
-    if (!f) f = fopen("/sys/class/power_supply/BAT1/present", "r");
-    if (!f) return bat;
-    if (fgets(buf, sizeof(buf), f)) bat.present = atoi(buf);
-    fclose(f);
-    if (!bat.present) return bat;
-
-    const char *bases[] = {"/sys/class/power_supply/BAT0", "/sys/class/power_supply/BAT1"};
-    const char *base = NULL;
-    for (int i = 0; i < 2; i++) {
-        char p[256];
-        snprintf(p, sizeof(p), "%s/capacity", bases[i]);
-        f = fopen(p, "r");
-        if (f) { base = bases[i]; fclose(f); break; }
+    char buf[128], base[256], p[320];
+    int i;
+    for (i = 0; i < 2; i++) {
+        snprintf(base, sizeof(base), "%.230s/class/power_supply/BAT%d", g_sys_root, i);
+        snprintf(p, sizeof(p), "%s/present", base);
+        if (read_sysfs_line(p, buf, sizeof(buf)) == 0) break;
     }
-    if (!base) return bat;
+    if (i == 2) return bat;
+    const char *v = buf;
+    bat.present = (int)scan_u64(&v);
+    if (!bat.present) return bat;
 
-    char p[256];
     snprintf(p, sizeof(p), "%s/capacity", base);
-    f = fopen(p, "r");
-    if (f) { if (fgets(buf, sizeof(buf), f)) bat.capacity = atoi(buf); fclose(f); }
+    if (read_sysfs_line(p, buf, sizeof(buf)) != 0) {
+        if (i == 1) return bat;
+        snprintf(base, sizeof(base), "%.230s/class/power_supply/BAT1", g_sys_root);
+        snprintf(p, sizeof(p), "%s/capacity", base);
+        if (read_sysfs_line(p, buf, sizeof(buf)) != 0) return bat;
+    }
+    v = buf;
+    bat.capacity = (int)scan_u64(&v);
 
     snprintf(p, sizeof(p), "%s/status", base);
-    f = fopen(p, "r");
-    if (f) {
-        if (fgets(buf, sizeof(buf), f)) {
-            buf[strcspn(buf, "\n")] = 0;
-            snprintf(bat.status, sizeof(bat.status), "%.15s", buf);
-            bat.charging = (strcmp(buf, "Charging") == 0);
-        }
-        fclose(f);
+    if (read_sysfs_line(p, buf, sizeof(buf)) == 0) {
+        snprintf(bat.status, sizeof(bat.status), "%.15s", buf);
+        bat.charging = (strcmp(buf, "Charging") == 0);
     }
     return bat;
 }
 
-gpu_info_t read_gpu(void) {
-    gpu_info_t g = {0};
-    FILE *f = popen("nvidia-smi --query-gpu=name,temperature.gpu,fan.speed,utilization.gpu,"
-                    "utilization.memory,memory.used,memory.total,power.draw,power.limit "
-                    "--format=csv,noheader,nounits 2>/dev/null", "r");
-    if (!f) return g;
-    char line[512];
-    if (fgets(line, sizeof(line), f)) {
-        char name[64];
-        int temp, fan, gpu_u, mem_u, mem_used, mem_total, pwr, pwr_max;
-        int n = sscanf(line, "%63[^,], %d, %d, %d, %d, %d, %d, %d, %d",
-                       name, &temp, &fan, &gpu_u, &mem_u, &mem_used, &mem_total, &pwr, &pwr_max);
-        if (n >= 7) {
-            g.has_gpu = 1;
-            snprintf(g.name, 64, "%.63s", name);
-            g.temp = temp;
-            g.fan_pct = fan;
-            g.gpu_util = gpu_u;
-            g.mem_util = mem_u;
-            g.mem_used_mb = mem_used;
-            g.mem_total_mb = mem_total;
-            g.power_w = (n >= 8) ? pwr : 0;
-            g.power_max_w = (n >= 9) ? pwr_max : 0;
+static int topo_cmp(const void *a, const void *b) {
+    const uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Orders the cores in st by NUMA node, then socket, then /proc/stat row.
+ * Cores whose node or package cannot be read land in node 0 / socket 0. */
+int read_cpu_topology(const cpu_stat_t *st, cpu_topo_t *t) {
+    int n = st->count - 1;
+    if (n <= 0 || n > MAX_CORES) return -1;
+    int maxid = 0;
+    for (int i = 1; i <= n; i++) if (st->id[i] > maxid) maxid = st->id[i];
+    int *row_of = malloc((maxid + 1) * sizeof(int));
+    uint64_t *key = calloc(n, sizeof(uint64_t));
+    uint16_t *order = malloc(n * sizeof(uint16_t));
+    if (!row_of || !key || !order) { free(row_of); free(key); free(order); return -1; }
+    for (int id = 0; id <= maxid; id++) row_of[id] = -1;
+    for (int i = 0; i < n; i++) if (st->id[i + 1] >= 0) row_of[st->id[i + 1]] = i;
+
+    char dir[400], path[512], buf[16384];
+    snprintf(dir, sizeof(dir), "%.370s/devices/system/node", g_sys_root);
+    DIR *d = opendir(dir);
+    struct dirent *de;
+    while (d && (de = readdir(d))) {
+        if (strncmp(de->d_name, "node", 4) != 0 || !isdigit((unsigned char)de->d_name[4])) continue;
+        snprintf(path, sizeof(path), "%s/%.32s/cpulist", dir, de->d_name);
+        if (read_sysfs_line(path, buf, sizeof(buf)) != 0) continue;
+        const char *np = de->d_name + 4;
+        uint64_t node = scan_u64(&np) & 0xffff;
+        for (const char *p = buf; *p; ) {
+            unsigned long long lo, hi;
+            if (!scan_u64_n(&p, &lo)) break;
+            hi = lo;
+            if (*p == '-') { p++; scan_u64_n(&p, &hi); }
+            for (unsigned long long c = lo; c <= hi && c <= (unsigned long long)maxid; c++)
+                if (row_of[c] >= 0) key[row_of[c]] |= node << 48;
+            if (*p == ',') p++;
+        }
+    }
+    if (d) closedir(d);
+    for (int i = 0; i < n; i++) {
+        snprintf(path, sizeof(path), "%.380s/devices/system/cpu/cpu%d/topology/physical_package_id",
+                 g_sys_root, st->id[i + 1]);
+        const char *v = buf;
+        if (read_sysfs_line(path, buf, sizeof(buf)) == 0) key[i] |= (scan_u64(&v) & 0xffff) << 32;
+        key[i] |= (uint64_t)i;
+    }
+    qsort(key, n, sizeof(uint64_t), topo_cmp);
+
+    t->ngroups = 0;
+    for (int i = 0; i < n; i++) {
+        order[i] = (uint16_t)(key[i] & 0xffffffff);
+        int node = (int)(key[i] >> 48), pkg = (int)(key[i] >> 32 & 0xffff);
+        cpu_group_t *g = t->ngroups ? &t->group[t->ngroups - 1] : NULL;
+        if (g && g->node == node && g->pkg == pkg) { g->len++; continue; }
+        if (t->ngroups == MAX_CPU_GROUPS) { g->len++; continue; }
+        t->group[t->ngroups++] = (cpu_group_t){ node, pkg, i, 1 };
+    }
+    free(t->order);
+    t->order = order;
+    t->n = n;
+    free(row_of);
+    free(key);
+    return 0;
+}
+
+#define GPU_QUERY "index,name,temperature.gpu,fan.speed,utilization.gpu,utilization.memory," \
+                  "memory.used,memory.total,power.draw,power.limit"
+
+static pid_t gpu_pid = -1;
+static int gpu_fd = -1;
+static char gpu_line[1024];
+static size_t gpu_line_len;
+static gpu_info_t gpu_latest[MAX_GPUS];
+static int gpu_seen, gpu_new_child;
+static double gpu_retry_at, gpu_retry_delay = 1, gpu_started_at;
+
+/* A child that stays up this long earns a fast restart; one that keeps
+ * dying sooner is restarted with growing backoff. */
+#define GPU_STABLE_S 30
+
+/* The last rows stay visible, marked stale, until a new child reports. */
+static void gpu_stop(void) {
+    if (gpu_fd >= 0) close(gpu_fd);
+    gpu_fd = -1;
+    if (gpu_pid > 0) {
+        if (waitpid(gpu_pid, NULL, WNOHANG) == 0) {
+            kill(gpu_pid, SIGTERM);
+            waitpid(gpu_pid, NULL, 0);
+        }
+    }
+    double now = mono_now();
+    if (gpu_pid > 0 && now - gpu_started_at >= GPU_STABLE_S) gpu_retry_delay = 1;
+    gpu_pid = -1;
+    gpu_line_len = 0;
+    for (int i = 0; i < gpu_seen; i++) gpu_latest[i].stale = 1;
+    gpu_retry_at = now + gpu_retry_delay;
+    if (gpu_retry_delay < 60) gpu_retry_delay *= 2;
+}
+
+static int gpu_spawn(int interval_ms) {
+    int p[2];
+    if (pipe2(p, O_CLOEXEC) != 0) return -1;
+    char lms[32];
+    snprintf(lms, sizeof(lms), "-lms=%d", interval_ms);
+    pid_t pid = fork();
+    if (pid < 0) { close(p[0]); close(p[1]); return -1; }
+    if (pid == 0) {
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        dup2(p[1], STDOUT_FILENO);
+        int dn = open("/dev/null", O_WRONLY);
+        if (dn >= 0) dup2(dn, STDERR_FILENO);
+        execlp("nvidia-smi", "nvidia-smi", "--query-gpu=" GPU_QUERY,
+               "--format=csv,noheader,nounits", lms, (char *)NULL);
+        _exit(127);
+    }
+    close(p[1]);
+    fcntl(p[0], F_SETFL, O_NONBLOCK);
+    gpu_pid = pid;
+    gpu_fd = p[0];
+    gpu_started_at = mono_now();
+    gpu_new_child = 1;
+    return 0;
+}
+
+static int gpu_field(char **p) {
+    char *f = *p, *end = strchr(f, ',');
+    if (end) { *end = 0; *p = end + 1; }
+    else *p = f + strlen(f);
+    const char *v = f;
+    double d;
+    if (!scan_f64_n(&v, &d)) return -1;
+    return (int)(d + 0.5);
+}
+
+static void gpu_parse_line(char *line) {
+    char *p = line;
+    int idx = gpu_field(&p);
+    if (idx < 0 || idx >= MAX_GPUS) return;
+    if (gpu_new_child) {
+        gpu_seen = 0;
+        gpu_new_child = 0;
+    }
+    char *name = p, *comma = strchr(p, ',');
+    if (!comma) return;
+    *comma = 0;
+    p = comma + 1;
+    gpu_info_t *g = &gpu_latest[idx];
+    g->index = idx;
+    while (*name == ' ') name++;
+    snprintf(g->name, sizeof(g->name), "%.63s", name);
+    g->temp = gpu_field(&p);
+    g->fan_pct = gpu_field(&p);
+    g->gpu_util = gpu_field(&p);
+    g->mem_util = gpu_field(&p);
+    g->mem_used_mb = gpu_field(&p);
+    g->mem_total_mb = gpu_field(&p);
+    g->power_w = gpu_field(&p);
+    g->power_max_w = gpu_field(&p);
+    if (g->power_w < 0) g->power_w = 0;
+    g->stale = 0;
+    if (idx + 1 > gpu_seen) gpu_seen = idx + 1;
+}
+
+/* nvidia-smi runs as a long-lived co-process streaming one CSV row per
+ * GPU every interval_ms; each call drains whatever rows are buffered
+ * and returns the latest values without blocking. With wait_ms > 0 it
+ * waits up to wait_ms for the first rows and then for the rest of that
+ * batch. A dead child is restarted with backoff; until the new one
+ * reports, the previous rows are returned with stale set. */
+int read_gpus(gpu_info_t *gpus, int max, int interval_ms, int wait_ms) {
+    if (gpu_fd < 0 && mono_now() >= gpu_retry_at && gpu_spawn(interval_ms) != 0) gpu_stop();
+    while (gpu_fd >= 0) {
+        char buf[4096];
+        ssize_t n = read(gpu_fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0) { gpu_stop(); break; }
+        if (n < 0) {
+            if (wait_ms <= 0) break;
+            struct pollfd pfd = { .fd = gpu_fd, .events = POLLIN };
+            if (poll(&pfd, 1, gpu_seen ? 50 : wait_ms) <= 0) break;
+            continue;
+        }
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] == '\n') {
+                gpu_line[gpu_line_len] = 0;
+                gpu_parse_line(gpu_line);
+                gpu_line_len = 0;
+            } else if (gpu_line_len < sizeof(gpu_line) - 1) {
+                gpu_line[gpu_line_len++] = buf[i];
+            }
         }
     }
-    pclose(f);
-    return g;
+    int count = gpu_seen < max ? gpu_seen : max;
+    memcpy(gpus, gpu_latest, count * sizeof(gpu_info_t));
+    return count;
+}
+
+typedef struct {
+    int used, seen;
+    char id[65];
+    char name[64];
+    char paths[CG_FILES][400];
+    proc_file_t files[CG_FILES];
+    unsigned long long prev_usage, prev_rbytes, prev_wbytes;
+    double prev_ts;
+} cg_container_t;
+
+static cg_container_t cg_cache[MAX_DOCKER];
+
+static void pf_close(proc_file_t *pf) {
+    if (pf->fd >= 0) close(pf->fd);
+    free(pf->buf);
+    pf->fd = -1;
+    pf->buf = NULL;
+    pf->cap = pf->len = 0;
+}
+
+static int is_container_id(const char *s, size_t len) {
+    if (len != 64) return 0;
+    for (size_t i = 0; i < len; i++)
+        if (!isxdigit((unsigned char)s[i])) return 0;
+    return 1;
+}
+
+/* Finds a string value under a top-level key of a JSON object, skipping
+ * nested objects and string contents; *len excludes the quotes. */
+static const char *json_top_str(const char *p, const char *key, size_t *len) {
+    size_t kl = strlen(key);
+    int depth = 0;
+    for (; *p; p++) {
+        if (*p == '{' || *p == '[') depth++;
+        else if (*p == '}' || *p == ']') depth--;
+        else if (*p == '"') {
+            const char *s = ++p;
+            while (*p && *p != '"') p += p[0] == '\\' && p[1] ? 2 : 1;
+            if (!*p) return NULL;
+            if (depth != 1 || (size_t)(p - s) != kl || memcmp(s, key, kl) != 0) continue;
+            const char *v = skip_blanks(p + 1);
+            if (*v != ':') continue;
+            v = skip_blanks(v + 1);
+            if (*v++ != '"') return NULL;
+            const char *e = v;
+            while (*e && *e != '"') e += e[0] == '\\' && e[1] ? 2 : 1;
+            *len = (size_t)(e - v);
+            return v;
+        }
+    }
+    return NULL;
+}
+
+/* Names never change for a running container, so config.v2.json is read
+ * once when the container first appears. "Name" comes after Config and
+ * NetworkSettings, which can run to hundreds of KB, so the whole file is
+ * read into a buffer kept across calls. */
+static void resolve_container_name(const char *id, char *name, size_t sz) {
+    static char *buf;
+    static size_t cap;
+    char path[512];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/containers/%s/config.v2.json", g_docker_root, id);
+    snprintf(name, sz, "%.12s", id);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) { close(fd); return; }
+    if ((size_t)st.st_size + 1 > cap) {
+        char *nb = realloc(buf, (size_t)st.st_size + 1);
+        if (!nb) { close(fd); return; }
+        buf = nb;
+        cap = (size_t)st.st_size + 1;
+    }
+    size_t n = 0;
+    ssize_t r;
+    while (n < cap - 1 && (r = read(fd, buf + n, cap - 1 - n)) > 0) n += (size_t)r;
+    close(fd);
+    buf[n] = 0;
+    size_t len;
+    const char *p = json_top_str(buf, "Name", &len);
+    if (!p) return;
+    if (*p == '/') { p++; len--; }
+    if (len == 0) return;
+    if (len >= sz) len = sz - 1;
+    memcpy(name, p, len);
+    name[len] = 0;
+}
+
+static cg_container_t *cg_track(const char *dir, const char *id) {
+    cg_container_t *free_slot = NULL;
+    for (int i = 0; i < MAX_DOCKER; i++) {
+        if (cg_cache[i].used && strcmp(cg_cache[i].id, id) == 0) return &cg_cache[i];
+        if (!cg_cache[i].used && !free_slot) free_slot = &cg_cache[i];
+    }
+    if (!free_slot) return NULL;
+    static const char *files[CG_FILES] = { "cpu.stat", "memory.current", "io.stat", "pids.current", "cgroup.freeze" };
+    cg_container_t *c = free_slot;
+    memset(c, 0, sizeof(*c));
+    c->used = 1;
+    snprintf(c->id, sizeof(c->id), "%s", id);
+    for (int f = 0; f < CG_FILES; f++) {
+        snprintf(c->paths[f], sizeof(c->paths[f]), "%.370s/%s", dir, files[f]);
+        c->files[f] = (proc_file_t)PROC_FILE(c->paths[f]);
+    }
+    resolve_container_name(id, c->name, sizeof(c->name));
+    return c;
+}
+
+static void cg_scan_dir(const char *parent, const char *prefix, const char *suffix) {
+    DIR *d = opendir(parent);
+    if (!d) return;
+    struct dirent *de;
+    size_t pl = strlen(prefix), sl = strlen(suffix);
+    while ((de = readdir(d))) {
+        size_t len = strlen(de->d_name);
+        if (len < pl + sl || strncmp(de->d_name, prefix, pl) != 0 ||
+            strcmp(de->d_name + len - sl, suffix) != 0) continue;
+        if (!is_container_id(de->d_name + pl, len - pl - sl)) continue;
+        char id[65], dir[400];
+        memcpy(id, de->d_name + pl, 64);
+        id[64] = 0;
+        snprintf(dir, sizeof(dir), "%.200s/%.190s", parent, de->d_name);
+        cg_container_t *c = cg_track(dir, id);
+        if (c) c->seen = 1;
+    }
+    closedir(d);
+}
+
+static unsigned long long cg_key(const char *buf, const char *key) {
+    size_t kl = strlen(key);
+    for (const char *p = buf; (p = strstr(p, key)); p += kl) {
+        if ((p == buf || p[-1] == '\n' || p[-1] == ' ') && (p[kl] == ' ' || p[kl] == '=')) {
+            p += kl + 1;
+            return scan_u64(&p);
+        }
+    }
+    return 0;
+}
+
+static void cg_io_totals(char *buf, unsigned long long *rbytes, unsigned long long *wbytes) {
+    char *line;
+    *rbytes = *wbytes = 0;
+    while ((line = next_line(&buf))) {
+        *rbytes += cg_key(line, "rbytes");
+        *wbytes += cg_key(line, "wbytes");
+    }
 }
 
 int read_docker(docker_info_t *containers, int max) {
-    FILE *f = popen("docker ps --format '{{.Names}}\\t{{.ID}}\\t{{.Status}}' 2>/dev/null", "r");
-    if (!f) return 0;
-    char line[256];
+    char parent[400];
+    for (int i = 0; i < MAX_DOCKER; i++) cg_cache[i].seen = 0;
+    snprintf(parent, sizeof(parent), "%.380s/system.slice", g_cgroup_root);
+    cg_scan_dir(parent, "docker-", ".scope");
+    snprintf(parent, sizeof(parent), "%.380s/docker", g_cgroup_root);
+    cg_scan_dir(parent, "", "");
+
     int count = 0;
-    while (fgets(line, sizeof(line), f) && count < max) {
-        line[strcspn(line, "\n")] = 0;
-        char name[64], id[16], status[64];
-        int n = sscanf(line, "%63[^\t]\t%15[^\t]\t%63[^\n]", name, id, status);
-        if (n < 2) continue;
-        snprintf(containers[count].name, 64, "%.63s", name);
-        snprintf(containers[count].id, 16, "%.12s", id);
-        snprintf(containers[count].status, 16, "%.15s", n >= 3 ? status : "?");
-        containers[count].cpu_pct = 0;
-        containers[count].mem_mb = 0;
-        count++;
+    double now = mono_now();
+    for (int i = 0; i < MAX_DOCKER; i++) {
+        cg_container_t *c = &cg_cache[i];
+        if (!c->used) continue;
+        char *cpu = c->seen ? pf_read(&c->files[CG_CPU]) : NULL;
+        if (!cpu) {
+            for (int f = 0; f < CG_FILES; f++) pf_close(&c->files[f]);
+            c->used = 0;
+            continue;
+        }
+        if (count >= max) continue;
+        docker_info_t *d = &containers[count++];
+        memset(d, 0, sizeof(*d));
+        snprintf(d->name, sizeof(d->name), "%s", c->name);
+        snprintf(d->id, sizeof(d->id), "%.12s", c->id);
+
+        unsigned long long usage = cg_key(cpu, "usage_usec");
+        char *buf = pf_read(&c->files[CG_MEM]);
+        const char *v;
+        if ((v = buf)) d->mem_mb = scan_u64(&v) / 1048576.0;
+        unsigned long long rb = 0, wb = 0;
+        buf = pf_read(&c->files[CG_IO]);
+        if (buf) cg_io_totals(buf, &rb, &wb);
+        if ((v = pf_read(&c->files[CG_PIDS]))) d->pids = (int)scan_u64(&v);
+        v = pf_read(&c->files[CG_FREEZE]);
+        snprintf(d->status, sizeof(d->status), "%s", v && scan_u64(&v) ? "paused" : "running");
+
+        double dt = now - c->prev_ts;
+        if (c->prev_ts > 0 && dt > 0) {
+            d->cpu_pct = (double)(usage - c->prev_usage) / (dt * 1e6) * 100.0;
+            d->io_read_bps = (double)(rb - c->prev_rbytes) / dt;
+            d->io_write_bps = (double)(wb - c->prev_wbytes) / dt;
+        }
+        c->prev_usage = usage;
+        c->prev_rbytes = rb;
+        c->prev_wbytes = wb;
+        c->prev_ts = now;
     }
-    pclose(f);
-
-    if (count > 0) {
-        f = popen("docker stats --no-stream --format '{{.Name}}\\t{{.CPUPerc}}\\t{{.MemUsage}}' 2>/dev/null", "r");
-        if (f) {
-            while (fgets(line, sizeof(line), f)) {
-                line[strcspn(line, "\n")] = 0;
-                char name[64], cpu_s[16], mem_s[64];
-                if (sscanf(line, "%63[^\t]\t%15[^\t]\t%63[^\n]", name, cpu_s, mem_s) < 2) continue;
-                double cpu = atof(cpu_s);
-                double mem = 0;
-                char *slash = strchr(mem_s, '/');
-                if (slash) {
-                    mem = atof(mem_s);
-                    if (strstr(mem_s, "GiB")) mem *= 1024;
-                }
-                for (int i = 0; i < count; i++) {
-                    if (strcmp(containers[i].name, name) == 0) {
-                        containers[i].cpu_pct = cpu;
-                        containers[i].mem_mb = mem;
-                        break;
-                    }
-                }
+    return count;
+}
+
+/* /proc/interrupts and /proc/softirqs hold one row per source and one
+ * column per CPU, megabytes of mostly unchanging text on big machines.
+ * The previous text is kept, so a row whose count columns are byte-for-byte
+ * the same as last time has a zero delta and costs one memcmp; changed rows
+ * are parsed with scan_cols and only sources that rank are named. */
+typedef struct {
+    char label[16];
+    size_t off;
+    int span;
+} irq_row_t;
+
+typedef struct {
+    proc_file_t pf;
+    char *old;
+    size_t old_cap;
+    int ncols, nrows, cap;
+    int *col_cpu;
+    irq_row_t *row;
+    uint32_t *count, *cur;
+    double ts;
+} irq_file_t;
+
+static irq_file_t irq_hard = { .pf = PROC_FILE("interrupts") };
+static irq_file_t irq_soft = { .pf = PROC_FILE("softirqs") };
+
+/* The header names the CPU of each column; a new set drops every baseline. */
+static int irq_header(irq_file_t *f, const char *p, const char *eol) {
+    int n = 0;
+    for (const char *q = p; (q = memmem(q, eol - q, "CPU", 3)); q += 3) n++;
+    if (!n) return -1;
+    if (n != f->ncols) {
+        int *col = malloc(n * sizeof(int));
+        uint32_t *cur = malloc(n * sizeof(uint32_t));
+        if (!col || !cur) { free(col); free(cur); return -1; }
+        free(f->col_cpu); free(f->cur); free(f->count); free(f->row);
+        f->col_cpu = col;
+        f->cur = cur;
+        f->count = NULL;
+        f->row = NULL;
+        f->ncols = n;
+        f->nrows = f->cap = 0;
+    }
+    n = 0;
+    for (const char *q = p; (q = memmem(q, eol - q, "CPU", 3)); n++) {
+        q += 3;
+        f->col_cpu[n] = (int)scan_u64(&q);
+    }
+    return 0;
+}
+
+static int irq_reserve(irq_file_t *f, int need) {
+    if (need <= f->cap) return 0;
+    int ncap = f->cap ? f->cap * 2 : 64;
+    irq_row_t *row = realloc(f->row, ncap * sizeof(irq_row_t));
+    if (!row) return -1;
+    f->row = row;
+    uint32_t *count = realloc(f->count, (size_t)ncap * f->ncols * sizeof(uint32_t));
+    if (!count) return -1;
+    f->count = count;
+    f->cap = ncap;
+    return 0;
+}
+
+/* Replaces the parsed counts in cur with their deltas and stores them in
+ * count. The kernel counters are 32-bit, so the subtraction wraps with them. */
+__attribute__((optimize("vect-cost-model=cheap")))
+static uint64_t irq_delta(uint32_t *restrict cur, uint32_t *restrict count, int n) {
+    uint64_t sum = 0;
+    for (int j = 0; j < n; j++) {
+        uint32_t d = cur[j] - count[j];
+        count[j] = cur[j];
+        cur[j] = d;
+        sum += d;
+    }
+    return sum;
+}
+
+/* Inserts a row into the rate-sorted top list; its per-CPU deltas are in f->cur. */
+static void irq_rank(irq_src_t *top, int *ntop, const irq_file_t *f, const char *lab, int ll,
+                     const char *tail, const char *eol, int n, double rate, double dt) {
+    if (*ntop == MAX_IRQ_TOP && rate <= top[MAX_IRQ_TOP - 1].rate) return;
+    int i = *ntop < MAX_IRQ_TOP ? (*ntop)++ : MAX_IRQ_TOP - 1;
+    for (; i > 0 && top[i - 1].rate < rate; i--) top[i] = top[i - 1];
+    irq_src_t *s = &top[i];
+    tail = skip_blanks(tail < eol ? tail : eol);
+    if (isdigit((unsigned char)*lab)) {
+        const char *sp = memrchr(tail, ' ', eol - tail);
+        if (sp) tail = sp + 1;
+    }
+    snprintf(s->name, sizeof(s->name), "%.*s%s%.*s", ll, lab, tail < eol ? " " : "", (int)(eol - tail), tail);
+    s->rate = rate;
+    s->ncpus = 0;
+    int k = 0;
+    for (int j = 0; j < n; j++) {
+        uint32_t d = f->cur[j];
+        if (!d) continue;
+        s->ncpus++;
+        float v = (float)(d / dt);
+        if (k == IRQ_TOP_CPUS && v <= s->cpu_rate[k - 1]) continue;
+        int at = k < IRQ_TOP_CPUS ? k++ : k - 1;
+        for (; at > 0 && s->cpu_rate[at - 1] < v; at--) {
+            s->cpu[at] = s->cpu[at - 1];
+            s->cpu_rate[at] = s->cpu_rate[at - 1];
+        }
+        s->cpu[at] = f->col_cpu[j];
+        s->cpu_rate[at] = v;
+    }
+    for (; k < IRQ_TOP_CPUS; k++) { s->cpu[k] = -1; s->cpu_rate[k] = 0; }
+}
+
+/* Looks lab up among n set-aside rows, starting at the one expected next. */
+static int irq_find(const irq_row_t *row, int n, int from, const char *lab, int ll) {
+    for (int k = 0; k < n; k++) {
+        int i = (from + k) % n;
+        if ((int)strlen(row[i].label) == ll && memcmp(row[i].label, lab, ll) == 0) return i;
+    }
+    return -1;
+}
+
+/* Rows are matched by position. When a label differs a source was added or
+ * removed, so the remaining previous rows are set aside and every later row
+ * takes its baseline from the one with the same label. */
+static int irq_read(irq_file_t *f, irq_src_t *top, int *ntop, double *rate) {
+    char *buf = pf_read(&f->pf);
+    *ntop = 0;
+    *rate = 0;
+    if (!buf) return -1;
+    char *end = buf + f->pf.len, *eol = memchr(buf, '\n', f->pf.len);
+    if (!eol || irq_header(f, buf, eol) != 0) return -1;
+    double now = mono_now(), dt = f->ts > 0 ? now - f->ts : 0;
+    f->ts = now;
+
+    uint64_t total = 0;
+    int r = 0, maxspan = 11 * f->ncols;
+    irq_row_t *snap = NULL;
+    uint32_t *snap_count = NULL;
+    int resync = 0, nsnap = 0, at = 0;
+    for (char *line = eol + 1; line < end; line = eol + 1, r++) {
+        eol = memchr(line, '\n', end - line);
+        if (!eol) eol = end;
+        char *colon = memchr(line, ':', eol - line);
+        if (!colon || irq_reserve(f, r + 1) != 0) break;
+        const char *lab = skip_blanks(line), *cols = colon + 1;
+        int ll = (int)(colon - lab), span = (int)(eol - cols);
+        if (ll > 15) ll = 15;
+        if (span > maxspan) span = maxspan;
+        irq_row_t *row = &f->row[r];
+        uint32_t *count = f->count + (size_t)r * f->ncols;
+        int known = !resync && r < f->nrows && (int)strlen(row->label) == ll && memcmp(row->label, lab, ll) == 0;
+        if (!known && !resync && r < f->nrows) {
+            resync = 1;
+            nsnap = f->nrows - r;
+            snap = malloc(nsnap * sizeof(irq_row_t));
+            snap_count = malloc((size_t)nsnap * f->ncols * sizeof(uint32_t));
+            if (snap && snap_count) {
+                memcpy(snap, row, nsnap * sizeof(irq_row_t));
+                memcpy(snap_count, count, (size_t)nsnap * f->ncols * sizeof(uint32_t));
+            } else nsnap = 0;
+        }
+        if (resync) {
+            int k = irq_find(snap, nsnap, at, lab, ll);
+            if (k >= 0) {
+                *row = snap[k];
+                memcpy(count, snap_count + (size_t)k * f->ncols, f->ncols * sizeof(uint32_t));
+                at = k + 1;
+                known = 1;
             }
-            pclose(f);
         }
+        int same = known && f->old && row->span == span && memcmp(f->old + row->off, cols, span) == 0;
+        row->off = (size_t)(cols - buf);
+        row->span = span;
+        if (same) continue;
+        int n = scan_cols(cols, eol + (eol < end), f->cur, f->ncols);
+        if (!known) {
+            memcpy(row->label, lab, ll);
+            row->label[ll] = 0;
+            memset(count, 0, f->ncols * sizeof(uint32_t));
+            memcpy(count, f->cur, n * sizeof(uint32_t));
+            continue;
+        }
+        uint64_t sum = irq_delta(f->cur, count, n);
+        total += sum;
+        if (sum && dt > 0) irq_rank(top, ntop, f, lab, ll, cols + 11 * n, eol, n, sum / dt, dt);
     }
-    return count;
+    f->nrows = r;
+    free(snap);
+    free(snap_count);
+    if (dt > 0) *rate = total / dt;
+
+    char *t = f->old;
+    size_t tc = f->old_cap;
+    f->old = f->pf.buf;
+    f->old_cap = f->pf.cap;
+    f->pf.buf = t;
+    f->pf.cap = tc;
+    return 0;
+}
+
+int read_irqs(irq_top_t *out) {
+    int hard = irq_read(&irq_hard, out->hard, &out->nhard, &out->hard_rate);
+    int soft = irq_read(&irq_soft, out->soft, &out->nsoft, &out->soft_rate);
+    return hard == 0 || soft == 0 ? 0 : -1;
+}
+
+static proc_file_t pf_psi[PSI_NRES] = {
+    PROC_FILE("pressure/cpu"), PROC_FILE("pressure/memory"), PROC_FILE("pressure/io"),
+};
+
+/* "avg10=0.12 avg60=0.05 avg300=0.01 total=12345" */
+static void psi_line(const char *p, double *avg, unsigned long long *total) {
+    for (int k = 0; k < 3 && (p = strchr(p, '=')); k++) {
+        p++;
+        avg[k] = scan_f64(&p);
+    }
+    if (p && (p = strchr(p, '='))) {
+        p++;
+        *total = scan_u64(&p);
+    }
+}
+
+int read_psi(psi_t *out) {
+    static unsigned long long prev_some[PSI_NRES], prev_full[PSI_NRES];
+    static double prev_ts[PSI_NRES];
+    int any = 0;
+    for (int r = 0; r < PSI_NRES; r++) {
+        psi_t *p = &out[r];
+        char *cur = pf_read(&pf_psi[r]), *line;
+        double now = mono_now();
+        p->present = cur != NULL;
+        if (!cur) continue;
+        any = 1;
+        while ((line = next_line(&cur))) {
+            if (strncmp(line, "some ", 5) == 0) psi_line(line + 5, p->some, &p->some_total);
+            else if (strncmp(line, "full ", 5) == 0) psi_line(line + 5, p->full, &p->full_total);
+        }
+        double dt = now - prev_ts[r];
+        if (prev_ts[r] > 0 && dt > 0) {
+            p->some_rate = (p->some_total - prev_some[r]) / (dt * 1e4);
+            p->full_rate = (p->full_total - prev_full[r]) / (dt * 1e4);
+            if (p->some_rate > 100) p->some_rate = 100;
+            if (p->full_rate > 100) p->full_rate = 100;
+        }
+        prev_some[r] = p->some_total;
+        prev_full[r] = p->full_total;
+        prev_ts[r] = now;
+    }
+    return any ? 0 : -1;
+}
+
+/* Registers a kernel PSI trigger on res: the returned fd polls POLLPRI
+ * once "some" stall time exceeds stall_us within any window_us. A
+ * --proc-root of regular files would have the spec written into it, so
+ * anything but procfs is refused and the caller falls back to polling. */
+int psi_trigger(int res, int stall_us, int window_us) {
+    int fd = root_open(g_proc_root, pf_psi[res].path, O_RDWR | O_NONBLOCK);
+    if (fd < 0) return -1;
+    struct statfs sf;
+    if (fstatfs(fd, &sf) != 0 || sf.f_type != PROC_SUPER_MAGIC) {
+        close(fd);
+        return -1;
+    }
+    char buf[64];
+    int n = snprintf(buf, sizeof(buf), "some %d %d", stall_us, window_us);
+    if (write(fd, buf, n + 1) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
 }
@@ -0,0 +1,553 @@
+#include "cutedash.h"
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Recording format: a 16-byte header, then frames of
+ *   varint length, flags byte, payload
+ * The payload walks sample_t in a fixed order. Every number is the delta
+ * against the value at the same position in the previous frame, zigzag
+ * varint coded, and runs of zero deltas collapse into one token. Strings
+ * are sent only when they differ from the previous frame's. A keyframe
+ * (REC_KEY) resets that state, so decoding can start there. FILE.idx holds
+ * a {wall_ms, offset} entry per keyframe for seeking. Version 2 appends
+ * the per-state CPU split; version 1 files still replay. */
+#define REC_MAGIC "CDREC1"
+#define REC_VERSION 2
+#define REC_HEADER 16
+#define REC_KEY 1
+#define REC_KEY_SECS 60
+#define REC_FLUSH (64 * 1024)
+#define REC_STR 128
+
+typedef struct {
+    int64_t wall_ms, offset;
+} rec_index_t;
+
+typedef struct {
+    int decode, err, version;
+    unsigned char *buf;
+    size_t len, cap;
+    const unsigned char *p, *end;
+    uint64_t zrun;
+    int64_t *vals;
+    int nvals, vi;
+    char (*strs)[REC_STR];
+    int nstrs, si;
+} codec_t;
+
+static int codec_reserve(codec_t *c, size_t n) {
+    if (c->len + n <= c->cap) return 0;
+    size_t ncap = c->cap ? c->cap : 16384;
+    while (ncap < c->len + n) ncap *= 2;
+    unsigned char *nb = realloc(c->buf, ncap);
+    if (!nb) { c->err = 1; return -1; }
+    c->buf = nb;
+    c->cap = ncap;
+    return 0;
+}
+
+static void put_varint(codec_t *c, uint64_t v) {
+    if (codec_reserve(c, 10) != 0) return;
+    while (v >= 0x80) { c->buf[c->len++] = (unsigned char)(v | 0x80); v >>= 7; }
+    c->buf[c->len++] = (unsigned char)v;
+}
+
+static uint64_t get_varint(codec_t *c) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (c->p >= c->end) { c->err = 1; return 0; }
+        unsigned char b = *c->p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    c->err = 1;
+    return 0;
+}
+
+/* Token stream: odd tokens are runs of zeros, even tokens carry a value. */
+static void emit(codec_t *c, uint64_t zz) {
+    if (!zz) { c->zrun++; return; }
+    if (c->zrun) { put_varint(c, c->zrun << 1 | 1); c->zrun = 0; }
+    put_varint(c, zz << 1);
+}
+
+static uint64_t take(codec_t *c) {
+    if (c->zrun) { c->zrun--; return 0; }
+    uint64_t t = get_varint(c);
+    if (t & 1) { c->zrun = (t >> 1) - 1; return 0; }
+    return t >> 1;
+}
+
+static uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static int64_t unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+static void c_i64(codec_t *c, int64_t *v) {
+    if (c->vi >= c->nvals) {
+        int n = c->nvals ? c->nvals * 2 : 1024;
+        while (n <= c->vi) n *= 2;
+        int64_t *nv = realloc(c->vals, n * sizeof(*nv));
+        if (!nv) { c->err = 1; return; }
+        memset(nv + c->nvals, 0, (n - c->nvals) * sizeof(*nv));
+        c->vals = nv;
+        c->nvals = n;
+    }
+    int64_t *prev = &c->vals[c->vi++];
+    if (c->decode) {
+        *prev += unzigzag(take(c));
+        *v = *prev;
+    } else {
+        emit(c, zigzag(*v - *prev));
+        *prev = *v;
+    }
+}
+
+static void c_str(codec_t *c, char *s, size_t sz) {
+    if (c->si >= c->nstrs) {
+        int n = c->nstrs ? c->nstrs * 2 : 256;
+        while (n <= c->si) n *= 2;
+        char (*ns)[REC_STR] = realloc(c->strs, n * sizeof(*ns));
+        if (!ns) { c->err = 1; return; }
+        for (int i = c->nstrs; i < n; i++) ns[i][0] = 0;
+        c->strs = ns;
+        c->nstrs = n;
+    }
+    char *prev = c->strs[c->si++];
+    if (c->decode) {
+        uint64_t t = take(c);
+        if (t) {
+            size_t len = t - 1;
+            if (len > (size_t)(c->end - c->p)) { c->err = 1; return; }
+            size_t keep = len < REC_STR - 1 ? len : REC_STR - 1;
+            memcpy(prev, c->p, keep);
+            prev[keep] = 0;
+            c->p += len;
+        }
+        snprintf(s, sz, "%s", prev);
+    } else {
+        if (strncmp(prev, s, REC_STR - 1) == 0) { emit(c, 0); return; }
+        size_t len = strnlen(s, REC_STR - 1);
+        emit(c, len + 1);
+        if (codec_reserve(c, len) != 0) return;
+        memcpy(c->buf + c->len, s, len);
+        c->len += len;
+        memcpy(prev, s, len);
+        prev[len] = 0;
+    }
+}
+
+#define C_INT(c, x) do { int64_t v_ = (int64_t)(x); c_i64(c, &v_); if ((c)->decode) (x) = v_; } while (0)
+#define C_FIX(c, x, scale) do { int64_t v_ = llround((x) * (scale)); c_i64(c, &v_); if ((c)->decode) (x) = v_ / (double)(scale); } while (0)
+#define C_COUNT(c, x, max) do { C_INT(c, x); if ((c)->decode && ((x) < 0 || (x) > (max))) { (x) = 0; (c)->err = 1; } } while (0)
+#define C_STR(c, s) c_str(c, s, sizeof(s))
+
+static void codec_begin(codec_t *c, int key) {
+    c->vi = c->si = 0;
+    c->zrun = 0;
+    if (key) {
+        if (c->vals) memset(c->vals, 0, c->nvals * sizeof(*c->vals));
+        for (int i = 0; i < c->nstrs; i++) c->strs[i][0] = 0;
+    }
+}
+
+static void codec_end(codec_t *c) {
+    if (c->zrun) { put_varint(c, c->zrun << 1 | 1); c->zrun = 0; }
+}
+
+static void codec_disk(codec_t *c, disk_io_t *dio) {
+    C_FIX(c, dio->read_speed, 1);
+    C_FIX(c, dio->write_speed, 1);
+    C_COUNT(c, dio->ndev, MAX_DISKS);
+    for (int i = 0; i < dio->ndev; i++) {
+        disk_dev_t *d = &dio->dev[i];
+        C_STR(c, d->name);
+        C_INT(c, d->partition);
+        C_FIX(c, d->read_iops, 10);
+        C_FIX(c, d->write_iops, 10);
+        C_FIX(c, d->read_bps, 1);
+        C_FIX(c, d->write_bps, 1);
+        C_FIX(c, d->util, 10);
+        C_FIX(c, d->await_ms, 100);
+        C_FIX(c, d->queue, 100);
+    }
+}
+
+static void codec_procs(codec_t *c, proc_table_t *pt) {
+    int n = pt->count;
+    C_COUNT(c, n, 1 << 22);
+    if (c->decode) proc_table_clear(pt);
+    for (int i = 0; i < n && !c->err; i++) {
+        if (!c->decode) {
+            C_INT(c, pt->pid[i]);
+            C_FIX(c, pt->cpu_pct[i], 100);
+            C_FIX(c, pt->mem_pct[i], 100);
+            c_str(c, PROC_NAME(pt, i), 0);
+            continue;
+        }
+        int pid = 0;
+        double cpu = 0, mem = 0;
+        char name[64];
+        C_INT(c, pid);
+        C_FIX(c, cpu, 100);
+        C_FIX(c, mem, 100);
+        C_STR(c, name);
+        if (proc_table_push(pt, pid, cpu, mem, name) != 0) c->err = 1;
+    }
+}
+
+static void codec_sample(codec_t *c, sample_t *s) {
+    C_FIX(c, s->wall, 1000);
+    C_INT(c, s->uptime);
+    C_COUNT(c, s->num_cores, MAX_CORES);
+    for (int i = 0; i < s->num_cores; i++) C_FIX(c, s->core_pcts[i], 100);
+    C_FIX(c, s->cpu_avg, 100);
+    C_FIX(c, s->load1, 100);
+    C_FIX(c, s->load5, 100);
+    C_FIX(c, s->load15, 100);
+
+    C_INT(c, s->mem_total); C_INT(c, s->mem_avail); C_INT(c, s->mem_used);
+    C_INT(c, s->mem_buf); C_INT(c, s->mem_cached); C_INT(c, s->sw_total); C_INT(c, s->sw_free);
+
+    C_COUNT(c, s->t_count, 32);
+    for (int i = 0; i < s->t_count; i++) {
+        C_STR(c, s->t_labels[i]);
+        C_FIX(c, s->t_vals[i], 10);
+        C_FIX(c, s->t_highs[i], 10);
+        C_FIX(c, s->t_crits[i], 10);
+    }
+    C_COUNT(c, s->fan_count, 16);
+    for (int i = 0; i < s->fan_count; i++) {
+        C_STR(c, s->fans[i].label);
+        C_INT(c, s->fans[i].rpm);
+    }
+
+    C_COUNT(c, s->num_ifaces, MAX_IFACES);
+    for (int i = 0; i < s->num_ifaces; i++) {
+        iface_t *f = &s->ifaces[i];
+        C_STR(c, f->name);
+        C_INT(c, f->rx); C_INT(c, f->tx);
+        C_FIX(c, f->rx_speed, 1); C_FIX(c, f->tx_speed, 1);
+    }
+    C_FIX(c, s->total_rx_speed, 1);
+    C_FIX(c, s->total_tx_speed, 1);
+
+    codec_disk(c, &s->disk_io);
+    C_COUNT(c, s->mount_count, MAX_MOUNTS);
+    for (int i = 0; i < s->mount_count; i++) {
+        C_STR(c, s->mounts[i].path);
+        C_FIX(c, s->mounts[i].used, 1);
+        C_FIX(c, s->mounts[i].total, 1);
+        C_INT(c, s->mounts[i].unresponsive);
+    }
+
+    codec_procs(c, &s->procs);
+
+    C_COUNT(c, s->gpu_count, MAX_GPUS);
+    for (int i = 0; i < s->gpu_count; i++) {
+        gpu_info_t *g = &s->gpus[i];
+        C_INT(c, g->index);
+        C_STR(c, g->name);
+        C_INT(c, g->temp); C_INT(c, g->fan_pct); C_INT(c, g->gpu_util); C_INT(c, g->mem_util);
+        C_INT(c, g->mem_used_mb); C_INT(c, g->mem_total_mb); C_INT(c, g->power_w); C_INT(c, g->power_max_w);
+    }
+    C_COUNT(c, s->docker_count, MAX_DOCKER);
+    for (int i = 0; i < s->docker_count; i++) {
+        docker_info_t *d = &s->docker[i];
+        C_STR(c, d->name); C_STR(c, d->id); C_STR(c, d->status);
+        C_FIX(c, d->cpu_pct, 100);
+        C_FIX(c, d->mem_mb, 10);
+        C_FIX(c, d->io_read_bps, 1); C_FIX(c, d->io_write_bps, 1);
+        C_INT(c, d->pids);
+    }
+    C_INT(c, s->bat.present); C_INT(c, s->bat.charging); C_INT(c, s->bat.capacity);
+    C_STR(c, s->bat.status);
+
+    if (c->version < 2) {
+        memset(s->cpu_state, 0, sizeof(s->cpu_state));
+        s->cpu_state[CPU_USER] = (float)s->cpu_avg;
+        for (int i = 0; i < s->num_cores; i++) {
+            for (int k = 0; k < CPU_NSTATES; k++) s->core_state[k][i] = 0;
+            s->core_state[CPU_USER][i] = (float)s->core_pcts[i];
+        }
+        return;
+    }
+    for (int k = 0; k < CPU_NSTATES; k++) {
+        C_FIX(c, s->cpu_state[k], 100);
+        for (int i = 0; i < s->num_cores; i++) C_FIX(c, s->core_state[k][i], 100);
+    }
+}
+
+static char *index_path(const char *path) {
+    size_t n = strlen(path);
+    char *p = malloc(n + 5);
+    if (p) { memcpy(p, path, n); memcpy(p + n, ".idx", 5); }
+    return p;
+}
+
+/* ---- recorder (sampler thread) ---- */
+
+static pthread_mutex_t rec_mu = PTHREAD_MUTEX_INITIALIZER;
+static int rec_fd = -1, rec_idx_fd = -1;
+static off_t rec_off;
+static double rec_last_key;
+static codec_t rec_frame, rec_out;
+
+int record_open(const char *path) {
+    int fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+    off_t size = lseek(fd, 0, SEEK_END);
+    if (size == 0) {
+        char hdr[REC_HEADER] = REC_MAGIC;
+        hdr[8] = REC_VERSION;
+        if (write(fd, hdr, sizeof(hdr)) != (ssize_t)sizeof(hdr)) { close(fd); return -1; }
+        size = REC_HEADER;
+    } else {
+        char hdr[REC_HEADER];
+        if (pread(fd, hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) ||
+            memcmp(hdr, REC_MAGIC, sizeof(REC_MAGIC)) != 0 || hdr[8] != REC_VERSION) {
+            close(fd);
+            return -1;
+        }
+    }
+    char *ip = index_path(path);
+    int ifd = ip ? open(ip, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644) : -1;
+    free(ip);
+    if (ifd < 0) { close(fd); return -1; }
+    pthread_mutex_lock(&rec_mu);
+    rec_fd = fd;
+    rec_idx_fd = ifd;
+    rec_frame.version = REC_VERSION;
+    rec_off = size;
+    rec_last_key = 0;
+    pthread_mutex_unlock(&rec_mu);
+    return 0;
+}
+
+static void record_flush(void) {
+    size_t done = 0;
+    while (done < rec_out.len) {
+        ssize_t n = write(rec_fd, rec_out.buf + done, rec_out.len - done);
+        if (n <= 0) break;
+        done += (size_t)n;
+    }
+    rec_out.len = 0;
+}
+
+void record_sample(const sample_t *s) {
+    pthread_mutex_lock(&rec_mu);
+    if (rec_fd < 0) { pthread_mutex_unlock(&rec_mu); return; }
+    int key = s->wall - rec_last_key >= REC_KEY_SECS || s->wall < rec_last_key;
+    if (key) {
+        record_flush();
+        rec_last_key = s->wall;
+    }
+    rec_frame.len = 0;
+    rec_frame.err = 0;
+    codec_begin(&rec_frame, key);
+    codec_sample(&rec_frame, (sample_t *)s);
+    codec_end(&rec_frame);
+    size_t before = rec_out.len;
+    put_varint(&rec_out, rec_frame.len + 1);
+    if (codec_reserve(&rec_out, rec_frame.len + 1) == 0 && !rec_frame.err) {
+        rec_out.buf[rec_out.len++] = key ? REC_KEY : 0;
+        memcpy(rec_out.buf + rec_out.len, rec_frame.buf, rec_frame.len);
+        rec_out.len += rec_frame.len;
+        if (key) {
+            rec_index_t e = { llround(s->wall * 1000), (int64_t)rec_off };
+            (void)!write(rec_idx_fd, &e, sizeof(e));
+        }
+        rec_off += (off_t)(rec_out.len - before);
+    } else {
+        rec_out.len = before;
+        rec_last_key = 0;
+    }
+    if (rec_out.len >= REC_FLUSH) record_flush();
+    pthread_mutex_unlock(&rec_mu);
+}
+
+void record_close(void) {
+    pthread_mutex_lock(&rec_mu);
+    if (rec_fd >= 0) {
+        record_flush();
+        close(rec_fd);
+        close(rec_idx_fd);
+        rec_fd = rec_idx_fd = -1;
+    }
+    pthread_mutex_unlock(&rec_mu);
+}
+
+/* ---- replay (UI thread) ---- */
+
+static const unsigned char *rp_map;
+static size_t rp_size, rp_pos;
+static rec_index_t *rp_idx;
+static int rp_nidx, rp_idx_cap;
+static codec_t rp_codec = { .decode = 1 };
+static sample_t rp_sample;
+
+static int frame_at(size_t off, size_t *payload, size_t *next, int *flags) {
+    codec_t c = { .decode = 1, .p = rp_map + off, .end = rp_map + rp_size };
+    uint64_t len = get_varint(&c);
+    if (c.err || len < 1 || len > (uint64_t)(c.end - c.p)) return -1;
+    *flags = *c.p;
+    *payload = (size_t)(c.p + 1 - rp_map);
+    *next = *payload + (size_t)len - 1;
+    return 0;
+}
+
+static int index_add(int64_t wall_ms, int64_t off) {
+    if (rp_nidx == rp_idx_cap) {
+        int ncap = rp_idx_cap ? rp_idx_cap * 2 : 64;
+        rec_index_t *ni = realloc(rp_idx, ncap * sizeof(*ni));
+        if (!ni) return -1;
+        rp_idx = ni;
+        rp_idx_cap = ncap;
+    }
+    rp_idx[rp_nidx].wall_ms = wall_ms;
+    rp_idx[rp_nidx++].offset = off;
+    return 0;
+}
+
+/* FILE.idx is trusted as far as its offsets stay increasing and inside the
+ * file; only its last entry is checked against the recording, so opening
+ * doesn't fault in the whole file. Keyframes missing from the tail (e.g.
+ * after a crash) are found by scanning from there. */
+static void index_load(const char *path) {
+    size_t scan = REC_HEADER;
+    char *ip = index_path(path);
+    int fd = ip ? open(ip, O_RDONLY | O_CLOEXEC) : -1;
+    free(ip);
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(rec_index_t)) {
+        int n = (int)(st.st_size / sizeof(rec_index_t));
+        rp_idx = malloc(n * sizeof(rec_index_t));
+        if (rp_idx && read(fd, rp_idx, n * sizeof(rec_index_t)) == (ssize_t)(n * sizeof(rec_index_t))) {
+            rp_idx_cap = n;
+            while (rp_nidx < n) {
+                const rec_index_t *e = &rp_idx[rp_nidx];
+                if (e->offset < REC_HEADER || (size_t)e->offset >= rp_size) break;
+                if (rp_nidx && e->offset <= rp_idx[rp_nidx - 1].offset) break;
+                rp_nidx++;
+            }
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+        size_t pl, nx;
+        int fl;
+        while (rp_nidx && (frame_at((size_t)rp_idx[rp_nidx - 1].offset, &pl, &nx, &fl) != 0 || !(fl & REC_KEY)))
+            rp_nidx--;
+        if (rp_nidx) scan = nx;
+    }
+    size_t pl, nx;
+    int fl;
+    while (scan < rp_size && frame_at(scan, &pl, &nx, &fl) == 0) {
+        if (fl & REC_KEY) {
+            codec_t c = { .decode = 1, .p = rp_map + pl, .end = rp_map + nx };
+            int64_t wall = unzigzag(take(&c));
+            if (!c.err) index_add(wall, (int64_t)scan);
+        }
+        scan = nx;
+    }
+}
+
+int replay_open(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < REC_HEADER) { close(fd); return -1; }
+    void *m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) return -1;
+    int version = ((char *)m)[8];
+    if (memcmp(m, REC_MAGIC, sizeof(REC_MAGIC)) != 0 || version < 1 || version > REC_VERSION) {
+        munmap(m, (size_t)st.st_size);
+        return -1;
+    }
+    rp_map = m;
+    rp_size = (size_t)st.st_size;
+    rp_codec.version = version;
+    index_load(path);
+    if (!rp_nidx) return -1;
+    rp_pos = (size_t)rp_idx[0].offset;
+    return replay_step() ? 0 : -1;
+}
+
+static void replay_feed_history(const sample_t *s) {
+    time_t t = (time_t)s->wall;
+    history_add(HIST_CPU, t, s->cpu_avg);
+    history_add(HIST_CPU_STEAL, t, s->cpu_state[CPU_STEAL]);
+    history_add(HIST_CPU_IOWAIT, t, s->cpu_state[CPU_IOWAIT]);
+    if (s->mem_total) history_add(HIST_MEM, t, (double)s->mem_used / s->mem_total * 100.0);
+    history_add(HIST_NET_RX, t, s->total_rx_speed);
+    history_add(HIST_NET_TX, t, s->total_tx_speed);
+    history_add(HIST_DISK_READ, t, s->disk_io.read_speed);
+    history_add(HIST_DISK_WRITE, t, s->disk_io.write_speed);
+    history_add_disks(&s->disk_io, t);
+    history_add(HIST_LOAD1, t, s->load1);
+    if (s->sw_total) history_add(HIST_SWAP, t, (double)(s->sw_total - s->sw_free) / s->sw_total * 100.0);
+    history_add_temps(s->t_labels, s->t_vals, s->t_count, t);
+    history_add_ifaces(s->ifaces, s->num_ifaces, t);
+    history_add_gpus(s->gpus, s->gpu_count, t);
+    for (int r = 0; r < PSI_NRES; r++)
+        if (s->psi[r].present) history_add(HIST_PSI_CPU + r, t, s->psi[r].some_rate);
+}
+
+/* Decodes the frame at the cursor into the replay sample; 0 at the end. */
+int replay_step(void) {
+    size_t pl, nx;
+    int fl;
+    if (rp_pos >= rp_size || frame_at(rp_pos, &pl, &nx, &fl) != 0) return 0;
+    rp_codec.p = rp_map + pl;
+    rp_codec.end = rp_map + nx;
+    rp_codec.err = 0;
+    codec_begin(&rp_codec, fl & REC_KEY);
+    codec_sample(&rp_codec, &rp_sample);
+    rp_pos = nx;
+    if (rp_codec.err) return 0;
+    rp_sample.valid = 1;
+    replay_feed_history(&rp_sample);
+    history_set_clock((time_t)rp_sample.wall);
+    return 1;
+}
+
+double replay_next_wall(void) {
+    size_t pl, nx;
+    int fl;
+    if (rp_pos >= rp_size || frame_at(rp_pos, &pl, &nx, &fl) != 0) return -1;
+    codec_t c = rp_codec;
+    c.p = rp_map + pl;
+    c.end = rp_map + nx;
+    c.zrun = 0;
+    int64_t prev = (fl & REC_KEY) || !c.nvals ? 0 : c.vals[0];
+    return (prev + unzigzag(take(&c))) / 1000.0;
+}
+
+static void replay_goto_key(double wall) {
+    int64_t ms = llround(wall * 1000);
+    int lo = 0, hi = rp_nidx - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (rp_idx[mid].wall_ms <= ms) lo = mid;
+        else hi = mid - 1;
+    }
+    rp_pos = (size_t)rp_idx[lo].offset;
+}
+
+/* Binary-search the keyframe index, then decode forward. The history
+ * store is rebuilt from the ten minutes before the target. */
+int replay_seek(double wall) {
+    if (wall < rp_idx[0].wall_ms / 1000.0) wall = rp_idx[0].wall_ms / 1000.0;
+    history_reset();
+    replay_goto_key(wall - 600);
+    if (!replay_step()) return -1;
+    double nw;
+    while ((nw = replay_next_wall()) >= 0 && nw <= wall)
+        if (!replay_step()) break;
+    return 0;
+}
+
+sample_t *replay_sample(void) { return &rp_sample; }
+double replay_first_wall(void) { return rp_nidx ? rp_idx[0].wall_ms / 1000.0 : 0; }
@@ -0,0 +1,434 @@
+#include "cutedash.h"
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/eventfd.h>
+
+cpu_stat_t prev_cpu;
+int num_cores = 0;
+cpu_topo_t cpu_topo;
+
+iface_t ifaces[MAX_IFACES];
+int num_ifaces = 0;
+
+disk_io_t disk_io = {0};
+
+/* Triple buffer: the sampler fills samples[back], then swaps it into the
+ * shared middle slot with SLOT_NEW set; the UI swaps its front slot with
+ * the middle one only when SLOT_NEW is present. Neither side ever blocks. */
+#define SLOT_NEW 4
+
+static sample_t samples[3];
+static atomic_int mid_slot = 1;
+static int back_slot = 0, front_slot = 2, last_slot = -1;
+static int wake_fd = -1;
+static pthread_t sampler_thread;
+
+/* Sampler-owned copy of everything except the process table, which is
+ * written straight into the back slot when the procs collector runs. */
+static sample_t cur;
+static int procs_fresh;
+
+/* The two stat tables swap roles every tick. When CPUs go on- or offline
+ * the rows no longer line up, so that tick only resets the baseline. */
+static void collect_cpu(void) {
+    static cpu_stat_t cur_cpu;
+    read_cpu_stats(&cur_cpu);
+    if (cur_cpu.count > 1 && cpu_stat_match(&cur_cpu, &prev_cpu)) {
+        cur.num_cores = num_cores < MAX_CORES ? num_cores : MAX_CORES;
+        calc_cpu_pct(&cur_cpu, &prev_cpu, 0, 1, &cur.cpu_avg, cur.cpu_state, 1);
+        calc_cpu_pct(&cur_cpu, &prev_cpu, 1, cur.num_cores, cur.core_pcts, cur.core_state[0], MAX_CORES);
+    } else if (cur_cpu.count > 1) {
+        num_cores = cur_cpu.count - 1;
+    }
+    cpu_stat_t t = prev_cpu;
+    prev_cpu = cur_cpu;
+    cur_cpu = t;
+
+    history_add(HIST_CPU, time(NULL), cur.cpu_avg);
+    history_add(HIST_CPU_STEAL, time(NULL), cur.cpu_state[CPU_STEAL]);
+    history_add(HIST_CPU_IOWAIT, time(NULL), cur.cpu_state[CPU_IOWAIT]);
+    read_loadavg(&cur.load1, &cur.load5, &cur.load15);
+    history_add(HIST_LOAD1, time(NULL), cur.load1);
+}
+
+static void collect_mem(void) {
+    read_mem(&cur.mem_total, &cur.mem_avail, &cur.mem_used, &cur.mem_buf, &cur.mem_cached,
+             &cur.sw_total, &cur.sw_free);
+    if (cur.mem_total) history_add(HIST_MEM, time(NULL), (double)cur.mem_used / cur.mem_total * 100.0);
+    if (cur.sw_total) history_add(HIST_SWAP, time(NULL), (double)(cur.sw_total - cur.sw_free) / cur.sw_total * 100.0);
+}
+
+static void collect_temps(void) {
+    cur.t_count = read_temps(cur.t_labels, cur.t_vals, cur.t_highs, cur.t_crits, 32);
+    history_add_temps(cur.t_labels, cur.t_vals, cur.t_count, time(NULL));
+}
+
+static void collect_fans(void) {
+    cur.fan_count = read_fans(cur.fans, 16);
+}
+
+static void collect_ifaces(void) {
+    cur.num_ifaces = read_ifaces(cur.ifaces, MAX_IFACES);
+    cur.total_rx_speed = cur.total_tx_speed = 0;
+    for (int i = 0; i < cur.num_ifaces; i++) {
+        cur.total_rx_speed += cur.ifaces[i].rx_speed;
+        cur.total_tx_speed += cur.ifaces[i].tx_speed;
+    }
+    memcpy(ifaces, cur.ifaces, sizeof(ifaces));
+    num_ifaces = cur.num_ifaces;
+
+    history_add(HIST_NET_RX, time(NULL), cur.total_rx_speed);
+    history_add(HIST_NET_TX, time(NULL), cur.total_tx_speed);
+    history_add_ifaces(cur.ifaces, cur.num_ifaces, time(NULL));
+}
+
+static void collect_disk(void) {
+    read_disk_io(&disk_io);
+    cur.disk_io = disk_io;
+    history_add(HIST_DISK_READ, time(NULL), disk_io.read_speed);
+    history_add(HIST_DISK_WRITE, time(NULL), disk_io.write_speed);
+    history_add_disks(&disk_io, time(NULL));
+    cur.mount_count = read_disk_usage(cur.mounts, MAX_MOUNTS, 0);
+}
+
+static void collect_procs(void) {
+    read_procs_with_cpu(&samples[back_slot].procs, cur.mem_total);
+    procs_fresh = 1;
+}
+
+static int gpu_stream_ms = REFRESH_MS;
+
+static void collect_gpu(void) {
+    cur.gpu_count = read_gpus(cur.gpus, MAX_GPUS, gpu_stream_ms, 0);
+    history_add_gpus(cur.gpus, cur.gpu_count, time(NULL));
+}
+
+static void collect_docker(void) {
+    cur.docker_count = read_docker(cur.docker, MAX_DOCKER);
+}
+
+static void collect_battery(void) {
+    cur.bat = read_battery();
+}
+
+static void collect_irq(void) {
+    read_irqs(&cur.irq);
+}
+
+static void collect_psi(void) {
+    read_psi(cur.psi);
+    for (int r = 0; r < PSI_NRES; r++)
+        if (cur.psi[r].present) history_add(HIST_PSI_CPU + r, time(NULL), cur.psi[r].some_rate);
+}
+
+/* Collectors run in table order within a tick, so mem precedes procs. */
+typedef struct collector {
+    const char *name;
+    void (*run)(void);
+    int interval_ms;
+    int budget_ms;
+    int backoff;
+    double last_cost_ms;
+    unsigned long long due;
+    int pending;
+    int fixed;
+    struct collector *next;
+    int prof;
+} collector_t;
+
+/* fixed = 1 collectors keep their own interval when --interval changes the base. */
+static collector_t collectors[] = {
+    { "cpu",     collect_cpu,     REFRESH_MS,   5, 1, 0, 0, 0, 0, NULL, 0 },
+    { "mem",     collect_mem,     REFRESH_MS,   5, 1, 0, 0, 0, 0, NULL, 0 },
+    { "temps",   collect_temps,   REFRESH_MS,  20, 1, 0, 0, 0, 0, NULL, 0 },
+    { "fans",    collect_fans,    REFRESH_MS,  20, 1, 0, 0, 0, 0, NULL, 0 },
+    { "ifaces",  collect_ifaces,  REFRESH_MS,   5, 1, 0, 0, 0, 0, NULL, 0 },
+    { "disk",    collect_disk,    REFRESH_MS,  50, 1, 0, 0, 0, 0, NULL, 0 },
+    { "procs",   collect_procs,   REFRESH_MS, 250, 1, 0, 0, 0, 0, NULL, 0 },
+    { "gpu",     collect_gpu,     REFRESH_MS,   5, 1, 0, 0, 0, 0, NULL, 0 },
+    { "docker",  collect_docker,  REFRESH_MS,  20, 1, 0, 0, 0, 0, NULL, 0 },
+    { "battery", collect_battery, 10000,       20, 1, 0, 0, 0, 1, NULL, 0 },
+    { "irq",     collect_irq,     REFRESH_MS,  10, 1, 0, 0, 0, 0, NULL, 0 },
+    { "psi",     collect_psi,     REFRESH_MS,   5, 1, 0, 0, 0, 0, NULL, 0 },
+};
+#define NCOLLECTORS ((int)(sizeof(collectors) / sizeof(collectors[0])))
+#define MAX_BACKOFF 16
+
+/* Hashed timer wheel: collector c sits in slot c->due % WHEEL_SLOTS and
+ * fires once the wheel reaches tick c->due. */
+#define WHEEL_TICK_MS MIN_INTERVAL_MS
+#define WHEEL_SLOTS 64
+
+static collector_t *wheel[WHEEL_SLOTS];
+static unsigned long long wheel_now;
+
+static void wheel_add(collector_t *c, unsigned long long due) {
+    c->due = due;
+    collector_t **slot = &wheel[due % WHEEL_SLOTS];
+    c->next = *slot;
+    *slot = c;
+}
+
+static int wheel_pop_due(void) {
+    int n = 0;
+    collector_t **pp = &wheel[wheel_now % WHEEL_SLOTS];
+    while (*pp) {
+        collector_t *c = *pp;
+        if (c->due <= wheel_now) {
+            *pp = c->next;
+            c->pending = 1;
+            n++;
+        } else pp = &c->next;
+    }
+    return n;
+}
+
+static unsigned long long wheel_next(void) {
+    for (unsigned long long t = wheel_now + 1; t <= wheel_now + WHEEL_SLOTS; t++)
+        for (collector_t *c = wheel[t % WHEEL_SLOTS]; c; c = c->next)
+            if (c->due <= t) return t;
+    return wheel_now + WHEEL_SLOTS;
+}
+
+static void run_collector(collector_t *c) {
+    uint64_t t0 = prof_clock();
+    c->run();
+    uint64_t ns = prof_clock() - t0;
+    prof_record(c->prof, ns);
+    c->last_cost_ms = ns / 1e6;
+    if (c->last_cost_ms > c->budget_ms && c->backoff < MAX_BACKOFF) c->backoff *= 2;
+    else if (c->last_cost_ms * 2 < c->budget_ms && c->backoff > 1) c->backoff /= 2;
+
+    unsigned long long ticks = ((unsigned long long)c->interval_ms * c->backoff + WHEEL_TICK_MS - 1) / WHEEL_TICK_MS;
+    wheel_add(c, wheel_now + (ticks ? ticks : 1));
+}
+
+static void publish_sample(void) {
+    sample_t *s = &samples[back_slot];
+    proc_table_t procs = s->procs;
+    *s = cur;
+    s->procs = procs;
+    if (!procs_fresh && last_slot >= 0) proc_table_copy(&s->procs, &samples[last_slot].procs);
+    procs_fresh = 0;
+    s->valid = 1;
+    s->ts = mono_now();
+    struct timespec wt;
+    clock_gettime(CLOCK_REALTIME, &wt);
+    s->wall = wt.tv_sec + wt.tv_nsec / 1e9;
+    struct sysinfo si;
+    s->uptime = sysinfo(&si) == 0 ? si.uptime : 0;
+    record_sample(s);
+    prof_tick();
+
+    last_slot = back_slot;
+    back_slot = atomic_exchange(&mid_slot, back_slot | SLOT_NEW) & 3;
+    uint64_t one = 1;
+    (void)!write(wake_fd, &one, sizeof(one));
+}
+
+/* Kernel PSI triggers on memory and io. The sampler sleeps in ppoll() on
+ * them, so a pressure spike is published as soon as it happens rather
+ * than at the next tick. */
+static int psi_stall_ms = 100, psi_window_ms = 1000;
+static struct pollfd psi_fds[PSI_NRES];
+static int psi_fd_res[PSI_NRES];
+static int npsi;
+
+/* Opens the configured trigger on res. Unprivileged triggers need a window
+ * that is a multiple of 2 s, so a refused trigger is retried at the next
+ * such window, stall scaled to match; *stall_ms and *window_ms get what
+ * was actually armed. */
+int sampler_psi_open(int res, int *stall_ms, int *window_ms) {
+    int stall = psi_stall_ms, window = psi_window_ms;
+    if (!window) return -1;
+    int fd = psi_trigger(res, stall * 1000, window * 1000);
+    if (fd < 0 && window % 2000) {
+        int w2 = (window / 2000 + 1) * 2000;
+        stall = (int)((long)stall * w2 / window);
+        window = w2;
+        fd = psi_trigger(res, stall * 1000, window * 1000);
+    }
+    *stall_ms = stall;
+    *window_ms = window;
+    return fd;
+}
+
+static void psi_arm(void) {
+    static const int res[] = { PSI_MEM, PSI_IO };
+    for (int i = 0; i < 2; i++) {
+        int stall, window;
+        int fd = sampler_psi_open(res[i], &stall, &window);
+        if (fd < 0) continue;
+        psi_fds[npsi] = (struct pollfd){ .fd = fd, .events = POLLPRI };
+        psi_fd_res[npsi++] = res[i];
+        cur.psi[res[i]].trig_stall_ms = stall;
+        cur.psi[res[i]].trig_window_ms = window;
+    }
+}
+
+static void psi_events(void) {
+    struct timespec wt;
+    clock_gettime(CLOCK_REALTIME, &wt);
+    int fired = 0;
+    for (int i = 0; i < npsi; i++) {
+        short ev = psi_fds[i].revents;
+        psi_t *p = &cur.psi[psi_fd_res[i]];
+        if (ev & (POLLERR | POLLNVAL)) {
+            close(psi_fds[i].fd);
+            p->trig_stall_ms = p->trig_window_ms = 0;
+            psi_fds[i] = psi_fds[--npsi];
+            psi_fd_res[i--] = psi_fd_res[npsi];
+        } else if (ev & POLLPRI) {
+            p->events++;
+            p->event_wall = wt.tv_sec + wt.tv_nsec / 1e9;
+            fired = 1;
+        }
+    }
+    if (!fired) return;
+    PROF("psi event", collect_psi());
+    publish_sample();
+}
+
+/* Sleeps until the absolute CLOCK_MONOTONIC time at, handling PSI events
+ * on the way. */
+static void sleep_until(const struct timespec *at) {
+    while (npsi) {
+        struct timespec now, left;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        left.tv_sec = at->tv_sec - now.tv_sec;
+        left.tv_nsec = at->tv_nsec - now.tv_nsec;
+        if (left.tv_nsec < 0) { left.tv_sec--; left.tv_nsec += 1000000000L; }
+        if (left.tv_sec < 0) return;
+        int n = ppoll(psi_fds, npsi, &left, NULL);
+        if (n == 0) return;
+        if (n < 0 && errno != EINTR) break;
+        if (n > 0) psi_events();
+    }
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, at, NULL) == EINTR) {}
+}
+
+static void *sampler_main(void *arg) {
+    (void)arg;
+    struct timespec epoch;
+    clock_gettime(CLOCK_MONOTONIC, &epoch);
+    for (;;) {
+        if (wheel_pop_due() > 0) {
+            for (int i = 0; i < NCOLLECTORS; i++) {
+                if (!collectors[i].pending) continue;
+                collectors[i].pending = 0;
+                run_collector(&collectors[i]);
+            }
+            publish_sample();
+        }
+        wheel_now = wheel_next();
+        unsigned long long ms = wheel_now * WHEEL_TICK_MS;
+        struct timespec at = {
+            .tv_sec = epoch.tv_sec + (time_t)(ms / 1000),
+            .tv_nsec = epoch.tv_nsec + (long)(ms % 1000) * 1000000L,
+        };
+        if (at.tv_nsec >= 1000000000L) { at.tv_sec++; at.tv_nsec -= 1000000000L; }
+        sleep_until(&at);
+    }
+    return NULL;
+}
+
+/* spec is NAME=INTERVAL_MS[:BUDGET_MS], e.g. "docker=10000:300". */
+int sampler_configure(const char *spec) {
+    const char *eq = strchr(spec, '=');
+    if (!eq) return -1;
+    for (int i = 0; i < NCOLLECTORS; i++) {
+        collector_t *c = &collectors[i];
+        if (strlen(c->name) != (size_t)(eq - spec) || strncmp(c->name, spec, eq - spec) != 0) continue;
+        char *end;
+        long iv = strtol(eq + 1, &end, 10);
+        if (iv < MIN_INTERVAL_MS) return -1;
+        long budget = c->budget_ms;
+        if (*end == ':') budget = strtol(end + 1, &end, 10);
+        if (*end || budget <= 0) return -1;
+        c->interval_ms = (int)iv;
+        c->budget_ms = (int)budget;
+        c->fixed = 1;
+        return 0;
+    }
+    return -1;
+}
+
+/* spec is STALL_MS/WINDOW_MS, e.g. "100/1000", or "none". The kernel
+ * accepts windows of 500 ms to 10 s. */
+int sampler_psi_trigger(const char *spec) {
+    if (strcmp(spec, "none") == 0) {
+        psi_window_ms = 0;
+        return 0;
+    }
+    char *end;
+    long stall = strtol(spec, &end, 10);
+    if (*end != '/') return -1;
+    long window = strtol(end + 1, &end, 10);
+    if (*end || window < 500 || window > 10000 || stall <= 0 || stall >= window) return -1;
+    psi_stall_ms = (int)stall;
+    psi_window_ms = (int)window;
+    return 0;
+}
+
+int sampler_set_interval(int ms) {
+    if (ms < MIN_INTERVAL_MS) return -1;
+    for (int i = 0; i < NCOLLECTORS; i++)
+        if (!collectors[i].fixed) collectors[i].interval_ms = ms;
+    return 0;
+}
+
+int sampler_load_config(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    char line[256];
+    int lineno = 0, bad = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        char *p = line;
+        while (isspace((unsigned char)*p)) p++;
+        p[strcspn(p, "#\r\n")] = 0;
+        for (char *e = p + strlen(p); e > p && isspace((unsigned char)e[-1]); ) *--e = 0;
+        if (!*p) continue;
+        if (sampler_configure(p) != 0) {
+            fprintf(stderr, "%s:%d: bad collector setting '%s'\n", path, lineno, p);
+            bad = 1;
+        }
+    }
+    fclose(f);
+    return bad ? -1 : 0;
+}
+
+/* Returns the eventfd that becomes readable whenever a new sample lands. */
+int sampler_start(void) {
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0) return -1;
+    read_cpu_stats(&prev_cpu);
+    num_cores = prev_cpu.count > 1 ? prev_cpu.count - 1 : 0;
+    read_cpu_topology(&prev_cpu, &cpu_topo);
+    num_ifaces = read_ifaces(ifaces, MAX_IFACES);
+    read_disk_io(&disk_io);
+    read_irqs(&cur.irq);
+    read_psi(cur.psi);
+    psi_arm();
+    for (int i = 0; i < NCOLLECTORS; i++) {
+        if (collectors[i].run == collect_gpu) gpu_stream_ms = collectors[i].interval_ms;
+        collectors[i].prof = prof_stage(collectors[i].name);
+        wheel_add(&collectors[i], 0);
+    }
+    usleep(200000);
+    if (pthread_create(&sampler_thread, NULL, sampler_main, NULL) != 0) return -1;
+    return wake_fd;
+}
+
+sample_t *sampler_acquire(int *fresh) {
+    uint64_t n;
+    (void)!read(wake_fd, &n, sizeof(n));
+    *fresh = 0;
+    if (atomic_load(&mid_slot) & SLOT_NEW) {
+        front_slot = atomic_exchange(&mid_slot, front_slot) & 3;
+        *fresh = 1;
+    }
+    return &samples[front_slot];
+}
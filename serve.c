@@ -0,0 +1,407 @@
+#include "cutedash.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+/* Headless exporter. The body is serialized once per published sample into
+ * one of two preallocated buffers; scrapes only copy it out, so they never
+ * touch /proc and never allocate. */
+#define SERVE_BODY (512 * 1024)
+#define SERVE_CLIENTS 64
+#define SERVE_REQ 2048
+#define SERVE_TOP_PROCS 10
+
+typedef struct {
+    char *buf;
+    size_t len;
+    int users;
+} om_body_t;
+
+typedef struct {
+    int fd;
+    char req[SERVE_REQ];
+    size_t rlen;
+    char head[256];
+    size_t head_len;
+    om_body_t *body;
+    const char *out;
+    size_t out_len, off;
+} client_t;
+
+static om_body_t bodies[2];
+static om_body_t *cur_body;
+static client_t clients[SERVE_CLIENTS];
+static volatile sig_atomic_t serve_stop;
+
+static void om_put(om_body_t *b, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void om_put(om_body_t *b, const char *fmt, ...) {
+    if (b->len >= SERVE_BODY) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(b->buf + b->len, SERVE_BODY - b->len, fmt, ap);
+    va_end(ap);
+    if (n > 0) b->len = (size_t)n < SERVE_BODY - b->len ? b->len + (size_t)n : SERVE_BODY;
+}
+
+/* Label values escape backslash, quote and newline per the exposition format. */
+static const char *om_label(char *dst, size_t sz, const char *s) {
+    size_t o = 0;
+    for (; *s && o + 2 < sz; s++) {
+        if (*s == '\\' || *s == '"') { dst[o++] = '\\'; dst[o++] = *s; }
+        else if (*s == '\n') { dst[o++] = '\\'; dst[o++] = 'n'; }
+        else dst[o++] = *s;
+    }
+    dst[o] = 0;
+    return dst;
+}
+
+static void om_family(om_body_t *b, const char *name, const char *type, const char *unit, const char *help) {
+    om_put(b, "# TYPE %s %s\n", name, type);
+    if (unit) om_put(b, "# UNIT %s %s\n", name, unit);
+    om_put(b, "# HELP %s %s\n", name, help);
+}
+
+static void build_body(om_body_t *b, sample_t *s) {
+    char l1[160], l2[160];
+    b->len = 0;
+
+    om_family(b, "cutedash_cpu_usage_percent", "gauge", NULL, "CPU busy time over the last interval.");
+    om_put(b, "cutedash_cpu_usage_percent{cpu=\"all\"} %.2f\n", s->cpu_avg);
+    for (int i = 0; i < s->num_cores; i++)
+        om_put(b, "cutedash_cpu_usage_percent{cpu=\"%d\"} %.2f\n", i, s->core_pcts[i]);
+    om_family(b, "cutedash_cpu_state_percent", "gauge", NULL, "Share of CPU time per state over the last interval.");
+    for (int k = 0; k < CPU_NSTATES; k++)
+        om_put(b, "cutedash_cpu_state_percent{state=\"%s\"} %.2f\n", cpu_state_names[k], s->cpu_state[k]);
+    om_family(b, "cutedash_load_average", "gauge", NULL, "System load average.");
+    om_put(b, "cutedash_load_average{period=\"1m\"} %.2f\n", s->load1);
+    om_put(b, "cutedash_load_average{period=\"5m\"} %.2f\n", s->load5);
+    om_put(b, "cutedash_load_average{period=\"15m\"} %.2f\n", s->load15);
+
+    om_family(b, "cutedash_memory_bytes", "gauge", "bytes", "Memory usage from /proc/meminfo.");
+    const char *mem_names[] = { "total", "available", "used", "buffers", "cached", "swap_total", "swap_free" };
+    unsigned long mem_vals[] = { s->mem_total, s->mem_avail, s->mem_used, s->mem_buf, s->mem_cached, s->sw_total, s->sw_free };
+    for (int i = 0; i < 7; i++)
+        om_put(b, "cutedash_memory_bytes{type=\"%s\"} %lu\n", mem_names[i], mem_vals[i] * 1024);
+
+    if (s->psi[PSI_CPU].present || s->psi[PSI_MEM].present || s->psi[PSI_IO].present) {
+        static const char *windows[] = { "10s", "60s", "300s" };
+        om_family(b, "cutedash_pressure_stalled_seconds", "counter", "seconds", "Time some or all tasks were stalled, from /proc/pressure.");
+        for (int r = 0; r < PSI_NRES; r++) {
+            if (!s->psi[r].present) continue;
+            om_put(b, "cutedash_pressure_stalled_seconds_total{resource=\"%s\",kind=\"some\"} %.6f\n", psi_names[r], s->psi[r].some_total / 1e6);
+            om_put(b, "cutedash_pressure_stalled_seconds_total{resource=\"%s\",kind=\"full\"} %.6f\n", psi_names[r], s->psi[r].full_total / 1e6);
+        }
+        om_family(b, "cutedash_pressure_average_percent", "gauge", NULL, "Kernel PSI running averages.");
+        for (int r = 0; r < PSI_NRES; r++) {
+            if (!s->psi[r].present) continue;
+            for (int k = 0; k < 3; k++) {
+                om_put(b, "cutedash_pressure_average_percent{resource=\"%s\",kind=\"some\",window=\"%s\"} %.2f\n", psi_names[r], windows[k], s->psi[r].some[k]);
+                om_put(b, "cutedash_pressure_average_percent{resource=\"%s\",kind=\"full\",window=\"%s\"} %.2f\n", psi_names[r], windows[k], s->psi[r].full[k]);
+            }
+        }
+        om_family(b, "cutedash_pressure_trigger_events", "counter", NULL, "PSI trigger firings since start.");
+        for (int r = 0; r < PSI_NRES; r++)
+            if (s->psi[r].trig_window_ms) om_put(b, "cutedash_pressure_trigger_events_total{resource=\"%s\"} %u\n", psi_names[r], s->psi[r].events);
+    }
+
+    if (s->t_count) {
+        om_family(b, "cutedash_temperature_celsius", "gauge", "celsius", "hwmon temperature sensors.");
+        for (int i = 0; i < s->t_count; i++)
+            om_put(b, "cutedash_temperature_celsius{sensor=\"%s\"} %.1f\n", om_label(l1, sizeof(l1), s->t_labels[i]), s->t_vals[i]);
+    }
+    if (s->fan_count) {
+        om_family(b, "cutedash_fan_rpm", "gauge", NULL, "hwmon fan speeds.");
+        for (int i = 0; i < s->fan_count; i++)
+            om_put(b, "cutedash_fan_rpm{fan=\"%s\"} %d\n", om_label(l1, sizeof(l1), s->fans[i].label), s->fans[i].rpm);
+    }
+
+    om_family(b, "cutedash_network_receive_bytes", "counter", "bytes", "Bytes received per interface.");
+    for (int i = 0; i < s->num_ifaces; i++)
+        om_put(b, "cutedash_network_receive_bytes_total{device=\"%s\"} %llu\n", om_label(l1, sizeof(l1), s->ifaces[i].name), s->ifaces[i].rx);
+    om_family(b, "cutedash_network_transmit_bytes", "counter", "bytes", "Bytes sent per interface.");
+    for (int i = 0; i < s->num_ifaces; i++)
+        om_put(b, "cutedash_network_transmit_bytes_total{device=\"%s\"} %llu\n", om_label(l1, sizeof(l1), s->ifaces[i].name), s->ifaces[i].tx);
+
+    const disk_io_t *dio = &s->disk_io;
+    if (dio->ndev) {
+        om_family(b, "cutedash_disk_throughput_bytes_per_second", "gauge", NULL, "Disk throughput per device.");
+        for (int i = 0; i < dio->ndev; i++) {
+            om_label(l1, sizeof(l1), dio->dev[i].name);
+            om_put(b, "cutedash_disk_throughput_bytes_per_second{device=\"%s\",op=\"read\"} %.0f\n", l1, dio->dev[i].read_bps);
+            om_put(b, "cutedash_disk_throughput_bytes_per_second{device=\"%s\",op=\"write\"} %.0f\n", l1, dio->dev[i].write_bps);
+        }
+        om_family(b, "cutedash_disk_iops", "gauge", NULL, "Completed I/Os per second per device.");
+        for (int i = 0; i < dio->ndev; i++) {
+            om_label(l1, sizeof(l1), dio->dev[i].name);
+            om_put(b, "cutedash_disk_iops{device=\"%s\",op=\"read\"} %.1f\n", l1, dio->dev[i].read_iops);
+            om_put(b, "cutedash_disk_iops{device=\"%s\",op=\"write\"} %.1f\n", l1, dio->dev[i].write_iops);
+        }
+        om_family(b, "cutedash_disk_utilization_percent", "gauge", NULL, "Time the device had I/O in flight.");
+        for (int i = 0; i < dio->ndev; i++)
+            om_put(b, "cutedash_disk_utilization_percent{device=\"%s\"} %.1f\n", om_label(l1, sizeof(l1), dio->dev[i].name), dio->dev[i].util);
+        om_family(b, "cutedash_disk_await_seconds", "gauge", "seconds", "Average I/O completion time.");
+        for (int i = 0; i < dio->ndev; i++)
+            om_put(b, "cutedash_disk_await_seconds{device=\"%s\"} %.6f\n", om_label(l1, sizeof(l1), dio->dev[i].name), dio->dev[i].await_ms / 1000.0);
+    }
+
+    if (s->mount_count) {
+        om_family(b, "cutedash_filesystem_size_bytes", "gauge", "bytes", "Filesystem size.");
+        for (int i = 0; i < s->mount_count; i++)
+            if (!s->mounts[i].unresponsive)
+                om_put(b, "cutedash_filesystem_size_bytes{mountpoint=\"%s\"} %.0f\n", om_label(l1, sizeof(l1), s->mounts[i].path), s->mounts[i].total);
+        om_family(b, "cutedash_filesystem_used_bytes", "gauge", "bytes", "Filesystem space in use.");
+        for (int i = 0; i < s->mount_count; i++)
+            if (!s->mounts[i].unresponsive)
+                om_put(b, "cutedash_filesystem_used_bytes{mountpoint=\"%s\"} %.0f\n", om_label(l1, sizeof(l1), s->mounts[i].path), s->mounts[i].used);
+        om_family(b, "cutedash_filesystem_unresponsive", "gauge", NULL, "1 if statvfs on the mount timed out.");
+        for (int i = 0; i < s->mount_count; i++)
+            om_put(b, "cutedash_filesystem_unresponsive{mountpoint=\"%s\"} %d\n", om_label(l1, sizeof(l1), s->mounts[i].path), s->mounts[i].unresponsive);
+    }
+
+    om_family(b, "cutedash_processes", "gauge", NULL, "Number of processes.");
+    om_put(b, "cutedash_processes %d\n", s->procs.count);
+    om_family(b, "cutedash_process_cpu_percent", "gauge", NULL, "CPU usage of the busiest processes.");
+    sort_procs(&s->procs, SORT_CPU, SERVE_TOP_PROCS);
+    for (int i = 0; i < s->procs.ntop; i++) {
+        uint32_t r = s->procs.order[i];
+        om_put(b, "cutedash_process_cpu_percent{pid=\"%d\",name=\"%s\"} %.2f\n", s->procs.pid[r],
+               om_label(l1, sizeof(l1), PROC_NAME(&s->procs, r)), s->procs.cpu_pct[r]);
+    }
+
+    if (s->gpu_count) {
+        om_family(b, "cutedash_gpu_utilization_percent", "gauge", NULL, "GPU utilization.");
+        for (int i = 0; i < s->gpu_count; i++)
+            om_put(b, "cutedash_gpu_utilization_percent{gpu=\"%d\",name=\"%s\"} %d\n", s->gpus[i].index, om_label(l1, sizeof(l1), s->gpus[i].name), s->gpus[i].gpu_util);
+        om_family(b, "cutedash_gpu_temperature_celsius", "gauge", "celsius", "GPU temperature.");
+        for (int i = 0; i < s->gpu_count; i++)
+            om_put(b, "cutedash_gpu_temperature_celsius{gpu=\"%d\"} %d\n", s->gpus[i].index, s->gpus[i].temp);
+        om_family(b, "cutedash_gpu_memory_used_bytes", "gauge", "bytes", "GPU memory in use.");
+        for (int i = 0; i < s->gpu_count; i++)
+            om_put(b, "cutedash_gpu_memory_used_bytes{gpu=\"%d\"} %lld\n", s->gpus[i].index, (long long)s->gpus[i].mem_used_mb << 20);
+        om_family(b, "cutedash_gpu_power_watts", "gauge", "watts", "GPU power draw.");
+        for (int i = 0; i < s->gpu_count; i++)
+            om_put(b, "cutedash_gpu_power_watts{gpu=\"%d\"} %d\n", s->gpus[i].index, s->gpus[i].power_w);
+        om_family(b, "cutedash_gpu_up", "gauge", NULL, "1 while nvidia-smi reports the GPU, 0 while the values above are stale.");
+        for (int i = 0; i < s->gpu_count; i++)
+            om_put(b, "cutedash_gpu_up{gpu=\"%d\"} %d\n", s->gpus[i].index, !s->gpus[i].stale);
+    }
+
+    if (s->docker_count) {
+        om_family(b, "cutedash_container_cpu_percent", "gauge", NULL, "Container CPU usage.");
+        for (int i = 0; i < s->docker_count; i++)
+            om_put(b, "cutedash_container_cpu_percent{name=\"%s\",id=\"%s\"} %.2f\n", om_label(l1, sizeof(l1), s->docker[i].name),
+                   om_label(l2, sizeof(l2), s->docker[i].id), s->docker[i].cpu_pct);
+        om_family(b, "cutedash_container_memory_bytes", "gauge", "bytes", "Container memory usage.");
+        for (int i = 0; i < s->docker_count; i++)
+            om_put(b, "cutedash_container_memory_bytes{name=\"%s\"} %.0f\n", om_label(l1, sizeof(l1), s->docker[i].name), s->docker[i].mem_mb * 1048576.0);
+        om_family(b, "cutedash_container_pids", "gauge", NULL, "Processes in the container.");
+        for (int i = 0; i < s->docker_count; i++)
+            om_put(b, "cutedash_container_pids{name=\"%s\"} %d\n", om_label(l1, sizeof(l1), s->docker[i].name), s->docker[i].pids);
+    }
+
+    if (s->bat.present) {
+        om_family(b, "cutedash_battery_capacity_percent", "gauge", NULL, "Battery charge.");
+        om_put(b, "cutedash_battery_capacity_percent{status=\"%s\"} %d\n", om_label(l1, sizeof(l1), s->bat.status), s->bat.capacity);
+    }
+    om_put(b, "# EOF\n");
+}
+
+/* The unix socket this process bound, so exit never removes a path that
+ * another instance has since taken over. */
+static const char *unix_path;
+static dev_t unix_dev;
+static ino_t unix_ino;
+
+/* An existing path is only replaced if it is a socket nobody answers on. */
+static int unix_stale(const char *path, const struct sockaddr_un *sa) {
+    struct stat st;
+    if (lstat(path, &st) != 0) return errno == ENOENT ? 0 : -1;
+    if (!S_ISSOCK(st.st_mode)) { errno = EEXIST; return -1; }
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe < 0) return -1;
+    int live = connect(probe, (const struct sockaddr *)sa, sizeof(*sa)) == 0 || errno != ECONNREFUSED;
+    close(probe);
+    if (live) { errno = EADDRINUSE; return -1; }
+    return unlink(path);
+}
+
+static int listen_on(const char *addr) {
+    int fd;
+    if (strncmp(addr, "unix:", 5) == 0 || addr[0] == '/') {
+        const char *path = addr[0] == '/' ? addr : addr + 5;
+        struct sockaddr_un sa = { .sun_family = AF_UNIX };
+        if (strlen(path) >= sizeof(sa.sun_path)) { errno = ENAMETOOLONG; return -1; }
+        strcpy(sa.sun_path, path);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        struct stat st;
+        if (unix_stale(path, &sa) != 0 || bind(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) { close(fd); return -1; }
+        if (lstat(path, &st) == 0) {
+            unix_path = path;
+            unix_dev = st.st_dev;
+            unix_ino = st.st_ino;
+        }
+    } else {
+        char host[256];
+        const char *colon = strrchr(addr, ':');
+        const char *port = colon ? colon + 1 : addr;
+        size_t hl = colon ? (size_t)(colon - addr) : 0;
+        if (hl >= sizeof(host)) { errno = EINVAL; return -1; }
+        memcpy(host, addr, hl);
+        host[hl] = 0;
+        if (hl >= 2 && host[0] == '[' && host[hl - 1] == ']') { memmove(host, host + 1, hl - 2); host[hl - 2] = 0; }
+        struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM, .ai_flags = AI_PASSIVE }, *res;
+        if (getaddrinfo(hl ? host : "127.0.0.1", port, &hints, &res) != 0) { errno = EINVAL; return -1; }
+        fd = socket(res->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+        if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (fd >= 0 && bind(fd, res->ai_addr, res->ai_addrlen) != 0) { close(fd); fd = -1; }
+        freeaddrinfo(res);
+        if (fd < 0) return -1;
+    }
+    if (listen(fd, 64) != 0) { close(fd); return -1; }
+    return fd;
+}
+
+static void client_close(client_t *c) {
+    if (c->body) c->body->users--;
+    close(c->fd);
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+}
+
+static void client_respond(client_t *c) {
+    char *end = memmem(c->req, c->rlen, "\r\n\r\n", 4);
+    size_t used = (size_t)(end - c->req) + 4;
+    int get = strncmp(c->req, "GET ", 4) == 0, head = strncmp(c->req, "HEAD ", 5) == 0;
+    const char *path = c->req + (head ? 5 : 4);
+    int metrics = (get || head) && strncmp(path, "/metrics", 8) == 0 && (path[8] == ' ' || path[8] == '?');
+    const char *status = !get && !head ? "405 Method Not Allowed" : !metrics ? "404 Not Found" :
+                         cur_body ? "200 OK" : "503 Service Unavailable";
+
+    c->body = NULL;
+    c->out = "";
+    c->out_len = 0;
+    if (metrics && cur_body) {
+        c->body = cur_body;
+        c->body->users++;
+        c->out = head ? "" : cur_body->buf;
+        c->out_len = head ? 0 : cur_body->len;
+    }
+    c->head_len = (size_t)snprintf(c->head, sizeof(c->head),
+        "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n\r\n", status,
+        metrics ? "application/openmetrics-text; version=1.0.0; charset=utf-8" : "text/plain",
+        metrics && cur_body ? cur_body->len : 0);
+    c->off = 0;
+    memmove(c->req, c->req + used, c->rlen - used);
+    c->rlen -= used;
+}
+
+/* Returns -1 when the connection should be dropped. */
+static int client_write(client_t *c) {
+    while (c->off < c->head_len + c->out_len) {
+        struct iovec iov[2];
+        int n = 0;
+        if (c->off < c->head_len) iov[n++] = (struct iovec){ c->head + c->off, c->head_len - c->off };
+        size_t bo = c->off > c->head_len ? c->off - c->head_len : 0;
+        if (c->out_len > bo) iov[n++] = (struct iovec){ (char *)c->out + bo, c->out_len - bo };
+        struct msghdr mh = { .msg_iov = iov, .msg_iovlen = n };
+        ssize_t w = sendmsg(c->fd, &mh, MSG_NOSIGNAL);
+        if (w < 0) return errno == EAGAIN || errno == EINTR ? 0 : -1;
+        c->off += (size_t)w;
+    }
+    if (c->body) { c->body->users--; c->body = NULL; }
+    c->head_len = c->out_len = c->off = 0;
+    return 0;
+}
+
+static int client_pending(const client_t *c) {
+    return c->off < c->head_len + c->out_len;
+}
+
+static void client_read(client_t *c) {
+    for (;;) {
+        if (client_pending(c)) return;
+        if (c->rlen && memmem(c->req, c->rlen, "\r\n\r\n", 4)) {
+            client_respond(c);
+            if (client_write(c) != 0) { client_close(c); return; }
+            continue;
+        }
+        if (c->rlen == SERVE_REQ) { client_close(c); return; }
+        ssize_t n = recv(c->fd, c->req + c->rlen, SERVE_REQ - c->rlen, 0);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) { client_close(c); return; }
+        if (n < 0) return;
+        c->rlen += (size_t)n;
+    }
+}
+
+static void serve_signal(int sig) { (void)sig; serve_stop = 1; }
+
+int serve_run(const char *addr) {
+    int lfd = listen_on(addr);
+    if (lfd < 0) { fprintf(stderr, "cutedash: cannot listen on %s: %s\n", addr, strerror(errno)); return 1; }
+    for (int i = 0; i < 2; i++) {
+        bodies[i].buf = malloc(SERVE_BODY);
+        if (!bodies[i].buf) return 1;
+    }
+    for (int i = 0; i < SERVE_CLIENTS; i++) clients[i].fd = -1;
+    int wake_fd = sampler_start();
+    if (wake_fd < 0) { perror("cutedash: sampler"); return 1; }
+
+    struct sigaction sa = { .sa_handler = serve_signal };
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    fprintf(stderr, "cutedash: serving /metrics on %s\n", addr);
+
+    struct pollfd pfds[SERVE_CLIENTS + 2];
+    while (!serve_stop) {
+        int np = 0;
+        pfds[np++] = (struct pollfd){ .fd = lfd, .events = POLLIN };
+        pfds[np++] = (struct pollfd){ .fd = wake_fd, .events = POLLIN };
+        for (int i = 0; i < SERVE_CLIENTS; i++)
+            pfds[np++] = (struct pollfd){ .fd = clients[i].fd, .events = client_pending(&clients[i]) ? POLLOUT : POLLIN };
+        if (poll(pfds, np, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        if (pfds[1].revents & POLLIN) {
+            int fresh;
+            sample_t *s = sampler_acquire(&fresh);
+            om_body_t *next = cur_body == &bodies[0] ? &bodies[1] : &bodies[0];
+            if (fresh && s->valid && next->users == 0) {
+                build_body(next, s);
+                cur_body = next;
+            }
+        }
+        for (int i = 0; i < SERVE_CLIENTS; i++) {
+            client_t *c = &clients[i];
+            short re = pfds[i + 2].revents;
+            if (c->fd < 0 || !re) continue;
+            if (re & (POLLERR | POLLNVAL)) { client_close(c); continue; }
+            if ((re & POLLOUT) && client_write(c) != 0) { client_close(c); continue; }
+            if (re & (POLLIN | POLLHUP | POLLOUT)) client_read(c);
+        }
+        if (pfds[0].revents & POLLIN) {
+            int fd;
+            while ((fd = accept4(lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                int slot = -1;
+                for (int i = 0; i < SERVE_CLIENTS && slot < 0; i++)
+                    if (clients[i].fd < 0) slot = i;
+                if (slot < 0) { close(fd); continue; }
+                memset(&clients[slot], 0, sizeof(client_t));
+                clients[slot].fd = fd;
+            }
+        }
+    }
+    struct stat st;
+    if (unix_path && lstat(unix_path, &st) == 0 && st.st_dev == unix_dev && st.st_ino == unix_ino) unlink(unix_path);
+    close(lfd);
+    return 0;
+}